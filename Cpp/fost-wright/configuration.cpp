@@ -26,6 +26,10 @@ const fostlib::setting<int64_t> wright::c_children(
         "Children",
         std::thread::hardware_concurrency(),
         true);
+const fostlib::setting<int64_t> wright::c_children_max(
+        __FILE__, "wright-exec-helper", "Maximum children", 0, true);
+const fostlib::setting<unsigned> wright::c_scale_interval(
+        __FILE__, "wright-exec-helper", "Scaling interval", 1000, true);
 
 const fostlib::setting<bool> wright::c_can_die(
         __FILE__, "wright-exec-helper", "Simulator can die", true, true);
@@ -59,15 +63,87 @@ const fostlib::setting<fostlib::json> wright::c_exec(
             return cmd;
         }(),
         true);
+const fostlib::setting<bool> wright::c_zygote(
+        __FILE__, "wright-exec-helper", "Zygote", false, true);
+const fostlib::setting<bool> wright::c_direct_supervision(
+        __FILE__, "wright-exec-helper", "Direct supervision", false, true);
+const fostlib::setting<bool> wright::c_framed(
+        __FILE__, "wright-exec-helper", "Framed protocol", false, true);
+const fostlib::setting<bool> wright::c_results(
+        __FILE__, "wright-exec-helper", "Capture results", false, true);
+const fostlib::setting<fostlib::nullable<fostlib::string>> wright::c_plugin(
+        __FILE__, "wright-exec-helper", "Plugin", fostlib::null, true);
+const fostlib::setting<std::size_t> wright::c_plugin_threads(
+        __FILE__,
+        "wright-exec-helper",
+        "Plugin threads",
+        std::thread::hardware_concurrency(),
+        true);
+const fostlib::setting<std::size_t> wright::c_plugin_retries(
+        __FILE__, "wright-exec-helper", "Plugin retries", 3, true);
+
+const fostlib::setting<fostlib::string> wright::c_duplicates(
+        __FILE__, "wright-exec-helper", "Duplicate jobs", "run", true);
+const fostlib::setting<unsigned> wright::c_output_flush_interval(
+        __FILE__, "wright-exec-helper", "Output flush interval", 50, true);
+const fostlib::setting<std::size_t> wright::c_output_flush_size(
+        __FILE__, "wright-exec-helper", "Output flush size", 64 << 10, true);
+const fostlib::setting<std::size_t> wright::c_output_high_water(
+        __FILE__, "wright-exec-helper", "Output high water", 16 << 20, true);
+
+const fostlib::setting<std::size_t> wright::c_queue_depth_min(
+        __FILE__, "wright-exec-helper", "Queue depth minimum", 1, true);
+const fostlib::setting<std::size_t> wright::c_queue_depth_max(
+        __FILE__, "wright-exec-helper", "Queue depth maximum", 16, true);
+const fostlib::setting<unsigned> wright::c_queue_target(
+        __FILE__, "wright-exec-helper", "Queue target time", 50, true);
+const fostlib::setting<std::size_t> wright::c_worker_concurrency(
+        __FILE__, "wright-exec-helper", "Worker concurrency", 1, true);
+
+const fostlib::setting<fostlib::string> wright::c_dispatch_policy(
+        __FILE__, "wright-exec-helper", "Dispatch policy", "round-robin", true);
+
+const fostlib::setting<fostlib::nullable<fostlib::string>> wright::c_cache(
+        __FILE__, "wright-exec-helper", "Result cache", fostlib::null, true);
+const fostlib::setting<fostlib::string> wright::c_cache_fingerprint(
+        __FILE__, "wright-exec-helper", "Result cache fingerprint", "", true);
+
+const fostlib::setting<fostlib::nullable<fostlib::string>> wright::c_journal(
+        __FILE__, "wright-exec-helper", "Journal", fostlib::null, true);
+const fostlib::setting<bool> wright::c_journal_resume(
+        __FILE__, "wright-exec-helper", "Resume from journal", false, true);
+const fostlib::setting<unsigned> wright::c_journal_commit_interval(
+        __FILE__, "wright-exec-helper", "Journal commit interval", 10, true);
+
+const fostlib::setting<fostlib::nullable<fostlib::string>> wright::c_input(
+        __FILE__, "wright-exec-helper", "Input file", fostlib::null, true);
+const fostlib::setting<unsigned> wright::c_progress_interval(
+        __FILE__, "wright-exec-helper", "Progress interval", 10, true);
 
 
 const fostlib::setting<uint16_t> wright::c_port(
         __FILE__, "wright-exec-helper", "Server port", 7788, true);
 const fostlib::setting<fostlib::nullable<fostlib::string>> wright::c_connect(
         __FILE__, "wright-exec-helper", "Connect to", fostlib::null, true);
+const fostlib::setting<unsigned> wright::c_session_grace(
+        __FILE__, "wright-exec-helper", "Session grace period", 30, true);
+const fostlib::setting<uint16_t> wright::c_relay_port(
+        __FILE__, "wright-exec-helper", "Relay port", 0, true);
 const fostlib::setting<std::size_t> wright::c_overspill_cap_per_worker(
         __FILE__,
         "wright-exec-helper",
         "Target overspill capacity per worker",
         1,
         true);
+const fostlib::setting<std::size_t> wright::c_overspill_memory(
+        __FILE__,
+        "wright-exec-helper",
+        "Overspill memory budget",
+        64 << 20,
+        true);
+const fostlib::setting<fostlib::string> wright::c_overspill_directory(
+        __FILE__, "wright-exec-helper", "Overspill directory", "/tmp", true);
+const fostlib::setting<std::size_t> wright::c_net_batch_size(
+        __FILE__, "wright-exec-helper", "Network batch size", 64, true);
+const fostlib::setting<unsigned> wright::c_net_batch_window(
+        __FILE__, "wright-exec-helper", "Network batch window", 2, true);
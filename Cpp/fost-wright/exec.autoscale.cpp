@@ -0,0 +1,83 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/configuration.hpp>
+#include <wright/exception.hpp>
+#include <wright/exec.autoscale.hpp>
+
+#include <fost/log>
+
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+
+namespace {
+
+
+    fostlib::performance p_grown(wright::c_exec_helper, "children", "added");
+    fostlib::performance
+            p_retired(wright::c_exec_helper, "children", "retired");
+
+
+    /// The number of intervals a child must be idle for before it is
+    /// retired
+    constexpr std::size_t idle_limit = 2;
+
+
+}
+
+
+void wright::add_autoscaler(
+        boost::asio::io_service &ctrlios,
+        capacity &cap,
+        std::function<void(childproc &)> serve) {
+    boost::asio::spawn(
+            ctrlios,
+            exception_decorator(
+                    [&ctrlios, &cap, serve = std::move(serve)](auto yield) {
+                        const std::size_t minimum = c_children.value();
+                        const std::size_t maximum = c_children_max.value();
+                        const auto interval = std::chrono::milliseconds{
+                                c_scale_interval.value()};
+                        boost::asio::steady_timer timer{ctrlios};
+                        while (not cap.input_complete.load()
+                               || cap.work_outstanding()) {
+                            timer.expires_from_now(interval);
+                            timer.async_wait(yield);
+                            /// Time the dispatcher spent with a job in hand
+                            /// and nowhere to put it
+                            const double waited = cap.dispatch_wait();
+                            std::size_t active{}, starting{};
+                            childproc *idle{};
+                            for (auto &child : cap.pool.children) {
+                                if (child.retiring) continue;
+                                ++active;
+                                if (not child.ready) {
+                                    ++starting;
+                                } else if (not child.idle()) {
+                                    child.idle_intervals = 0;
+                                } else if (
+                                        ++child.idle_intervals >= idle_limit) {
+                                    idle = &child;
+                                }
+                            }
+                            /// Only one child is added at a time, and not
+                            /// until the last one is ready, so that a
+                            /// burst doesn't start more than are needed
+                            if (waited * 2000 > interval.count()
+                                && not starting && active < maximum) {
+                                ++p_grown;
+                                serve(cap.grow());
+                            } else if (not waited && idle && active > minimum) {
+                                ++p_retired;
+                                cap.retire(*idle);
+                            }
+                        }
+                    },
+                    exit_on_error));
+}
@@ -0,0 +1,184 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/configuration.hpp>
+#include <wright/exec.cache.hpp>
+
+#include <fost/log>
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+
+
+    /// The file header. The count is the number of keys, after the header,
+    /// that are in sorted order.
+    struct header {
+        char magic[8];
+        uint64_t sorted;
+    };
+    const char c_magic[8] = {'w', 'r', 'i', 'g', 'h', 't', 'c', 1};
+
+    /// Keys are written in batches
+    const std::size_t c_pending_limit = 512u;
+
+
+    void write_all(int fd, const void *data, std::size_t bytes) {
+        auto p = static_cast<const char *>(data);
+        while (bytes) {
+            auto const written = ::write(fd, p, bytes);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::system_category());
+            }
+            p += written;
+            bytes -= written;
+        }
+    }
+
+
+}
+
+
+wright::result_cache::result_cache(std::string fn, std::string fp)
+: filename(std::move(fn)), fingerprint(std::move(fp)) {
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::system_error(errno, std::system_category());
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+    std::size_t size = st.st_size;
+    if (size == 0u) {
+        /// A new file
+        header h{};
+        std::memcpy(h.magic, c_magic, sizeof(c_magic));
+        write_all(fd, &h, sizeof(h));
+        return;
+    }
+    if (size < sizeof(header)) {
+        throw fostlib::exceptions::not_implemented(
+                __func__, "This file isn't a Wright result cache",
+                fostlib::string{filename});
+    }
+    /// Drop a partial record left by a crash so appends stay aligned
+    const std::size_t records = (size - sizeof(header)) / sizeof(job_key);
+    if (size != sizeof(header) + records * sizeof(job_key)) {
+        size = sizeof(header) + records * sizeof(job_key);
+        if (::ftruncate(fd, size) < 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+    }
+    mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::system_error(errno, std::system_category());
+    }
+    mapping_size = size;
+    auto const *h = static_cast<const header *>(mapping);
+    if (std::memcmp(h->magic, c_magic, sizeof(c_magic))) {
+        throw fostlib::exceptions::not_implemented(
+                __func__, "This file isn't a Wright result cache",
+                fostlib::string{filename});
+    }
+    sorted = reinterpret_cast<const job_key *>(h + 1);
+    sorted_count = std::min<std::size_t>(h->sorted, records);
+    const auto unsorted = records - sorted_count;
+    if (unsorted > std::max<std::size_t>(sorted_count / 8u, 4096u)) {
+        compact(records);
+    } else {
+        tail.insert(sorted + sorted_count, sorted + records);
+    }
+    fostlib::log::info(c_exec_helper)("", "Opened result cache")(
+            "filename", filename.c_str())("sorted", sorted_count)(
+            "unsorted", tail.size());
+}
+
+
+wright::result_cache::~result_cache() {
+    try {
+        flush();
+    } catch (...) {
+        fostlib::log::error(c_exec_helper)(
+                "", "Could not write result cache")(
+                "filename", filename.c_str());
+    }
+    if (mapping) ::munmap(mapping, mapping_size);
+    if (fd >= 0) ::close(fd);
+}
+
+
+void wright::result_cache::compact(std::size_t records) {
+    std::vector<job_key> keys(sorted, sorted + records);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    /// Write the new file alongside the old one and then move it into place
+    const auto temporary = filename + ".tmp";
+    int nfd = ::open(
+            temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (nfd < 0) throw std::system_error(errno, std::system_category());
+    header h{};
+    std::memcpy(h.magic, c_magic, sizeof(c_magic));
+    h.sorted = keys.size();
+    write_all(nfd, &h, sizeof(h));
+    write_all(nfd, keys.data(), keys.size() * sizeof(job_key));
+    ::fsync(nfd);
+    ::close(nfd);
+    if (::rename(temporary.c_str(), filename.c_str()) < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+    ::munmap(mapping, mapping_size);
+    ::close(fd);
+    mapping = nullptr;
+    fd = ::open(filename.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::system_category());
+    mapping_size = sizeof(header) + keys.size() * sizeof(job_key);
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::system_error(errno, std::system_category());
+    }
+    sorted = reinterpret_cast<const job_key *>(
+            static_cast<const header *>(mapping) + 1);
+    sorted_count = keys.size();
+    fostlib::log::info(c_exec_helper)("", "Compacted result cache")(
+            "filename", filename.c_str())("records", "before", records)(
+            "records", "after", sorted_count);
+}
+
+
+bool wright::result_cache::contains(std::string_view job) const {
+    const auto key = job_key::make(job, fingerprint);
+    return std::binary_search(sorted, sorted + sorted_count, key)
+            || tail.find(key) != tail.end();
+}
+
+
+void wright::result_cache::insert(std::string_view job) {
+    const auto key = job_key::make(job, fingerprint);
+    if (std::binary_search(sorted, sorted + sorted_count, key)) return;
+    if (tail.insert(key).second) {
+        pending.push_back(key);
+        if (pending.size() >= c_pending_limit) flush();
+    }
+}
+
+
+void wright::result_cache::flush() {
+    if (pending.empty()) return;
+    write_all(fd, pending.data(), pending.size() * sizeof(job_key));
+    pending.clear();
+}
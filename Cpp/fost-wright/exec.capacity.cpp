@@ -13,6 +13,12 @@
 
 #include <fost/log>
 
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
 #include <sys/wait.h>
 
 
@@ -21,65 +27,235 @@ namespace {
 
     fostlib::performance p_accepted(wright::c_exec_helper, "jobs", "accepted");
     fostlib::performance p_completed(wright::c_exec_helper, "jobs", "completed");
+    fostlib::performance
+            p_coalesced(wright::c_exec_helper, "jobs", "coalesced");
 
 
 }
 
 
 wright::capacity::capacity(boost::asio::io_service &ios, child_pool &p)
-: limit(ios, p.children.size() * wright::buffer_size),
+: limit(ios,
+        std::accumulate(
+                p.children.begin(),
+                p.children.end(),
+                std::size_t{},
+                [](std::size_t t, auto const &c) {
+                    return c.ready ? t + c.depth : t;
+                })),
+  policy(scheduler::make(c_dispatch_policy.value(), p)),
   pool(p),
   overspill(ios) {}
 
 
-void wright::capacity::next_job(
-        std::string job, boost::asio::yield_context yield) {
-    /// First of all we wait for a spare slot in one of the work queues.
-    /// The limit capacity must exactly equal the total slot capacity in
-    /// all queues.
-    auto task = limit.next_job(yield);
+void wright::capacity::next_job(task job, boost::asio::yield_context yield) {
     ++p_accepted;
-    /// Try to put the work out over the network first before doing anything
-    /// locally.
-    for (auto &cxv : connections) {
-        auto cnx = cxv.first.lock();
-        if (cnx && cxv.second.cap > cxv.second.work.size()) {
-            cxv.second.work[job] = std::move(task);
-            cnx->queue.produce(out::execute(std::move(job)));
+    while (true) {
+        /// First of all we wait for a spare slot in one of the work queues.
+        /// The limit capacity must exactly equal the total slot capacity in
+        /// all queues.
+        fostlib::timer blocked;
+        auto task = limit.next_job(yield);
+        waiting += blocked.seconds();
+        /// Try to put the work out over the network first before doing
+        /// anything locally. The connection chosen is the one with spare
+        /// capacity that has had the least work relative to its weight.
+        while (not ready.empty()) {
+            auto [pass, id, rmt] = *ready.begin();
+            auto cnx = rmt->cnx.lock();
+            if (not cnx) {
+                /// The connection is going away and its work will be
+                /// redistributed, so don't send it anything else
+                ready.erase(ready.begin());
+                rmt->key.reset();
+                continue;
+            }
+            const auto given = job.id;
+            job.id = rmt->work.insert({job.command, std::move(task), given});
+            rmt->pass = pass + 1.0 / weight(*rmt);
+            update_ready(id, *rmt);
+            cnx->execute(std::move(job));
+            return;
+        }
+        if (plugins) {
+            plugins->execute(wright::job{
+                    std::move(job.command), std::move(task), {}, job.id});
             return;
+        } else if (pool.active()) {
+            if (const auto child_index = policy->select(); child_index) {
+                auto &child{pool.children[*child_index]};
+                wright::job work{std::move(job.command), std::move(task), {},
+                                 job.id, child.next_sequence++};
+                child.write(limit.get_io_service(), work, yield);
+                child.commands.push_back(std::move(work));
+                policy->changed(*child_index);
+                return;
+            }
         }
+        /// The space was held by a connection that is closing, so give the
+        /// slot back and try again once the connection's capacity has been
+        /// removed
+        task.reset();
+        boost::asio::steady_timer retry{limit.get_io_service()};
+        retry.expires_from_now(std::chrono::milliseconds{10});
+        retry.async_wait(yield);
+    }
+}
+
+
+double wright::capacity::weight(const remote &rmt) const {
+    /// A connection's weight is the number of jobs we expect it to finish
+    /// each second, which is its capacity divided by how long its jobs
+    /// take. Until a connection has finished a job we assume it is as
+    /// fast as the network connections have been on average.
+    const double time = rmt.mean_time
+            ? rmt.mean_time
+            : remote_mean_time ? remote_mean_time : 1.0;
+    return std::max<uint64_t>(rmt.cap, 1u) / time;
+}
+
+
+void wright::capacity::update_ready(int64_t id, remote &rmt) {
+    if (rmt.key) {
+        ready.erase(*rmt.key);
+        rmt.key.reset();
+    }
+    if (rmt.cap > rmt.work.size()) {
+        rmt.key = std::make_tuple(rmt.pass, id, &rmt);
+        ready.insert(*rmt.key);
+    }
+}
+
+
+wright::capacity::duplicates
+        wright::capacity::duplicate_handling(const fostlib::string &setting) {
+    if (setting == "run") {
+        return duplicates::run;
+    } else if (setting == "each") {
+        return duplicates::each;
+    } else if (setting == "once") {
+        return duplicates::once;
+    } else {
+        throw fostlib::exceptions::not_implemented(
+                __func__, "Unknown duplicate job handling", setting);
+    }
+}
+
+
+std::size_t wright::capacity::job_done(childproc &child, const job &done) {
+    if (child.retiring) {
+        /// The child's queue is no longer part of the limit
+        if (child.idle()) child.stdin.close();
+        return job_done(done.command);
+    }
+    const auto change = child.record_time(done.time.seconds());
+    policy->changed(child.number - 1u);
+    if (change > 0) {
+        limit.increase_limit(change);
+    } else if (change < 0) {
+        limit.decrease_limit(-change);
+    }
+    if (change) {
+        fostlib::log::debug(child.counters->reference)(
+                "", "Queue depth changed")("depth", child.depth)(
+                "mean-time", child.mean_time)("limit", limit.limit());
     }
-    do {
-        /** Do a rotate left first so we won't try the
-            same child two times in a row without trying
-            the others first. This should spread the jobs
-            out across.
-        */
-        ++child_index;
-        child_index = child_index % pool.children.size();
-    } while (pool.children[child_index].commands.full());
-    auto &child{pool.children[child_index]};
-    child.write(limit.get_io_service(), job, yield);
-    child.commands.push_back(wright::job{job, std::move(task)});
+    return job_done(done.command);
 }
 
 
-void wright::capacity::job_done(const std::string &job) { ++p_completed; }
+bool wright::capacity::coalesced(const std::string &job) {
+    if (coalesce == duplicates::run) return false;
+    auto [pos, inserted] = in_flight.emplace(job, 1u);
+    if (not inserted) {
+        ++pos->second;
+        ++p_coalesced;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+
+std::size_t wright::capacity::job_done(const std::string &job) {
+    ++p_completed;
+    if (coalesce == duplicates::run) return 1u;
+    auto pos = in_flight.find(job);
+    if (pos == in_flight.end()) return 1u;
+    const auto submitted = pos->second;
+    in_flight.erase(pos);
+    return coalesce == duplicates::each ? submitted : 1u;
+}
 
 
 void wright::capacity::job_done(
         std::shared_ptr<connection> cnx, const std::string &job) {
+    job_done(cnx, std::vector<std::string>{job});
+}
+
+
+void wright::capacity::job_done(
+        std::shared_ptr<connection> cnx, const std::vector<std::string> &jobs) {
+    /// Older clients report the job text rather than its ID, so we have
+    /// to search for it.
+    auto &rmt = connections[cnx];
+    std::vector<uint64_t> ids;
+    ids.reserve(jobs.size());
+    for (auto const &job : jobs) {
+        auto id = rmt.work.find_if(
+                [&job](auto const &w) { return w.command == job; });
+        if (id) {
+            ids.push_back(*id);
+        } else {
+            fostlib::log::error(c_exec_helper)(
+                    "",
+                    "Got a job that isn't outstanding for this network "
+                    "connection")("connection", "id", cnx->id)(
+                    "job", job.c_str());
+        }
+    }
+    job_done(cnx, ids);
+}
+
+
+void wright::capacity::job_done(
+        std::shared_ptr<connection> cnx, const std::vector<uint64_t> &ids) {
+    auto &rmt = connections[cnx];
+    for (auto const id : ids) remote_done(*cnx, rmt, id, {});
+    update_ready(cnx->id, rmt);
+}
+
+
+void wright::capacity::job_done(
+        std::shared_ptr<connection> cnx,
+        const std::vector<std::pair<uint64_t, std::string>> &results) {
     auto &rmt = connections[cnx];
-    auto pos = rmt.work.find(job);
-    if (pos == rmt.work.end()) {
+    for (auto const &[id, result] : results) {
+        remote_done(*cnx, rmt, id, result);
+    }
+    update_ready(cnx->id, rmt);
+}
+
+
+void wright::capacity::remote_done(
+        connection &cnx,
+        remote &rmt,
+        uint64_t id,
+        std::optional<std::string_view> result) {
+    if (auto done = rmt.work.erase(id); done) {
+        const auto taken = done->time.seconds();
+        rmt.mean_time =
+                rmt.mean_time ? 0.8 * rmt.mean_time + 0.2 * taken : taken;
+        remote_mean_time = remote_mean_time
+                ? 0.95 * remote_mean_time + 0.05 * taken
+                : taken;
+        const auto times = job_done(done->command);
+        if (report) report(done->command, times, result, done->id);
+    } else {
         fostlib::log::error(c_exec_helper)(
                 "",
-                "Got a job that isn't outstanding for this network connection")(
-                "connection", "id", cnx->id)("job", job.c_str());
-    } else {
-        rmt.work.erase(pos);
-        job_done(job);
-        std::cout << job << std::endl;
+                "Got a job ID that isn't outstanding for this network "
+                "connection")("connection", "id", cnx.id)("job", id);
     }
 }
 
@@ -96,22 +272,44 @@ void wright::capacity::overspill_work(std::shared_ptr<connection> cnx) {
     */
     auto prmt = connections.find(cnx);
     if (prmt != connections.end()) {
-        for (auto &w : prmt->second.work) {
-            overspill.produce(std::string(w.first));
+        prmt->second.work.for_each([&](auto &w) {
+            overspill.produce(task{std::move(w.command), w.id});
             ++redist;
-        }
+        });
         logger("jobs", redist);
         logger("limit", limit.decrease_limit(prmt->second.cap));
+        if (prmt->second.key) ready.erase(*prmt->second.key);
         connections.erase(prmt);
+        tell_upstream();
     }
 }
 
 
-void wright::capacity::additional(std::shared_ptr<connection> cnx, uint64_t cap) {
+void wright::capacity::additional(
+        std::shared_ptr<connection> cnx,
+        uint64_t cap,
+        std::optional<uint64_t> session) {
     auto found = connections.find(cnx);
     if (found == connections.end()) {
-        connections[cnx] = remote{cap};
+        auto resuming = session ? take_session(*session) : std::nullopt;
+        auto &rmt = connections[cnx];
+        if (resuming) {
+            rmt = std::move(*resuming);
+            rmt.unconfirmed = rmt.work.ids();
+            fostlib::log::warning(c_exec_helper)("", "Client session resumed")(
+                    "connection", "id", cnx->id)("jobs", rmt.work.size());
+        } else {
+            /// Start the new connection at the current virtual time so that
+            /// it gets its fair share from now on, rather than all of the
+            /// work until it has caught up with the others
+            rmt.pass = ready.empty() ? 0.0 : std::get<0>(*ready.begin());
+        }
+        rmt.cap = cap;
+        rmt.cnx = cnx;
+        rmt.session = session;
+        update_ready(cnx->id, rmt);
         limit.increase_limit(cap);
+        tell_upstream();
     } else {
         throw fostlib::exceptions::not_implemented(
                 __func__, "Where the connection is already known");
@@ -119,6 +317,240 @@ void wright::capacity::additional(std::shared_ptr<connection> cnx, uint64_t cap)
 }
 
 
+std::optional<wright::capacity::remote>
+        wright::capacity::take_session(uint64_t session) {
+    if (auto found = parked.find(session); found != parked.end()) {
+        auto rmt = std::move(found->second.rmt);
+        /// The tokens still held by the work are counted again as part of
+        /// the new connection's capacity
+        limit.decrease_limit(found->second.reserved);
+        /// Destroying the timer cancels the expiry
+        parked.erase(found);
+        return rmt;
+    }
+    /// The client may have noticed the old connection had gone before we
+    /// did. It won't be used again, so close it
+    for (auto pos = connections.begin(); pos != connections.end(); ++pos) {
+        if (pos->second.session != session) continue;
+        auto rmt = std::move(pos->second);
+        if (rmt.key) ready.erase(*rmt.key);
+        rmt.key.reset();
+        limit.decrease_limit(rmt.cap);
+        if (auto old = rmt.cnx.lock(); old) old->socket.close();
+        connections.erase(pos);
+        return rmt;
+    }
+    return {};
+}
+
+
+void wright::capacity::disconnected(std::shared_ptr<connection> cnx) {
+    auto prmt = connections.find(cnx);
+    if (prmt == connections.end() || not prmt->second.session
+        || cnx->version() < 7u || not c_session_grace.value()) {
+        overspill_work(cnx);
+        return;
+    }
+    const auto session = *prmt->second.session;
+    auto &park = parked[session];
+    park.rmt = std::move(prmt->second);
+    if (park.rmt.key) ready.erase(*park.rmt.key);
+    park.rmt.key.reset();
+    connections.erase(prmt);
+    /// The parked work keeps its limiter tokens, so only the rest of the
+    /// connection's capacity is taken out of the limit for now
+    park.reserved = std::min<std::size_t>(park.rmt.work.size(), park.rmt.cap);
+    park.expired = false;
+    fostlib::log::warning(c_exec_helper)("", "Holding work for lost client")(
+            "connection", "id", cnx->id)("jobs", park.rmt.work.size())(
+            "limit", limit.decrease_limit(park.rmt.cap - park.reserved))(
+            "grace", c_session_grace.value());
+    start_expiry(park, session);
+    tell_upstream();
+}
+
+
+void wright::capacity::start_expiry(parked_session &park, uint64_t session) {
+    if (not park.expiry) {
+        park.expiry = std::make_unique<boost::asio::steady_timer>(
+                limit.get_io_service());
+    }
+    park.expiry->expires_from_now(
+            std::chrono::seconds{c_session_grace.value()});
+    park.expiry->async_wait([this, session](boost::system::error_code error) {
+        if (not error) expire(session);
+    });
+}
+
+
+void wright::capacity::expire(uint64_t session) {
+    auto found = parked.find(session);
+    if (found == parked.end()) return;
+    auto &park = found->second;
+    if (park.expired) {
+        /// The client has had long enough to notice its old jobs are gone
+        fostlib::log::info(c_exec_helper)("", "Forgetting lost client session")(
+                "session", int64_t(session));
+        parked.erase(found);
+        return;
+    }
+    std::size_t redist{};
+    park.rmt.work.drain([&](auto &&w) {
+        overspill.produce(task{std::move(w.command), w.id});
+        ++redist;
+    });
+    /// Draining the work released its tokens
+    limit.decrease_limit(std::exchange(park.reserved, 0u));
+    park.expired = true;
+    start_expiry(park, session);
+    fostlib::log::warning(c_exec_helper)(
+            "", "Lost client didn't come back -- re-distributing its work")(
+            "jobs", redist)("limit", limit.limit());
+}
+
+
+void wright::capacity::resumed(
+        std::shared_ptr<connection> cnx, const std::vector<uint64_t> &ids) {
+    auto found = connections.find(cnx);
+    if (found == connections.end()) return;
+    auto &rmt = found->second;
+    const std::unordered_set<uint64_t> kept{ids.begin(), ids.end()};
+    std::size_t redist{};
+    for (auto const id : rmt.unconfirmed) {
+        if (kept.count(id)) continue;
+        /// Either the job or its completion was lost along with the old
+        /// connection, so it has to be run again
+        if (auto w = rmt.work.erase(id); w) {
+            overspill.produce(task{std::move(w->command), w->id});
+            ++redist;
+        }
+    }
+    rmt.unconfirmed.clear();
+    update_ready(cnx->id, rmt);
+    fostlib::log::info(c_exec_helper)("", "Client confirmed its jobs")(
+            "connection", "id", cnx->id)("jobs", "kept", rmt.work.size())(
+            "jobs", "redistributed", redist);
+}
+
+
+void wright::capacity::received(uint64_t id) { holding.insert(id); }
+
+
+void wright::capacity::upstream_connected(std::shared_ptr<connection> cnx) {
+    upstream = cnx;
+    /// A relay's capacity may have changed since the version packet was
+    /// sent, and until now we didn't know if we could say so
+    tell_upstream();
+    if (cnx->version() >= 7u) {
+        cnx->queue.produce(out::session_resume(
+                std::vector<uint64_t>{holding.begin(), holding.end()}));
+    }
+    for (auto &[job, id, result] : std::exchange(held, {})) {
+        report_upstream(std::move(job), id, std::move(result));
+    }
+}
+
+
+void wright::capacity::report_upstream(
+        std::string job,
+        std::optional<uint64_t> id,
+        std::optional<std::string> result) {
+    auto up = upstream.lock();
+    if (not up || up->closed()) {
+        held.emplace_back(std::move(job), id, std::move(result));
+    } else {
+        if (id) holding.erase(*id);
+        up->completed(std::move(job), id, std::move(result));
+    }
+}
+
+
+void wright::capacity::update(std::shared_ptr<connection> cnx, uint64_t cap) {
+    auto found = connections.find(cnx);
+    if (found == connections.end()) {
+        fostlib::log::error(c_exec_helper)(
+                "", "Capacity change for an unknown connection")(
+                "connection", "id", cnx->id)("capacity", cap);
+        return;
+    }
+    auto &rmt = found->second;
+    if (cap > rmt.cap) {
+        limit.increase_limit(cap - rmt.cap);
+    } else if (cap < rmt.cap) {
+        limit.decrease_limit(rmt.cap - cap);
+    }
+    rmt.cap = cap;
+    update_ready(cnx->id, rmt);
+    tell_upstream();
+}
+
+
+void wright::capacity::tell_upstream() {
+    if (auto up = upstream.lock(); up && up->version() >= 6u) {
+        up->queue.produce(out::capacity_update(advertised()));
+    }
+}
+
+
+void wright::capacity::child_ready(childproc &child) {
+    if (child.ready) return;
+    child.ready = true;
+    policy->changed(child.number - 1u);
+    limit.increase_limit(child.depth);
+    fostlib::log::debug(child.counters->reference)("", "Child ready")(
+            "pid", child.pid)("limit", limit.limit());
+}
+
+
+wright::childproc &wright::capacity::grow() {
+    auto &child = pool.add();
+    fostlib::log::info(child.counters->reference)("", "Adding child")(
+            "pid", child.pid)("children", pool.active());
+    if (c_direct_supervision.value()) child_ready(child);
+    return child;
+}
+
+
+void wright::capacity::retire(childproc &child) {
+    if (child.retiring) return;
+    child.retiring = true;
+    policy->changed(child.number - 1u);
+    if (child.ready) limit.decrease_limit(child.depth);
+    fostlib::log::info(child.counters->reference)("", "Retiring child")(
+            "pid", child.pid)("job", "count", child.commands.size())(
+            "children", pool.active());
+    if (child.idle()) child.stdin.close();
+}
+
+
+std::size_t wright::capacity::local() const {
+    std::size_t total = plugins ? plugins->capacity() : 0u;
+    for (auto const &child : pool.children) {
+        if (not child.retiring) total += child.depth;
+    }
+    return total;
+}
+
+
+std::size_t wright::capacity::advertised() const {
+    return std::accumulate(
+            connections.begin(), connections.end(),
+            local() + c_overspill_cap_per_worker.value() * children(),
+            [](std::size_t t, auto const &c) { return t + c.second.cap; });
+}
+
+
+double wright::capacity::dispatch_wait() {
+    return std::exchange(waiting, 0.0);
+}
+
+
+void wright::capacity::use_plugins(std::unique_ptr<plugin_pool> p) {
+    plugins = std::move(p);
+    limit.increase_limit(plugins->capacity());
+}
+
+
 bool wright::capacity::all_done() const {
     if (input_complete.load()) {
         const auto outstanding = limit.outstanding();
@@ -137,8 +569,9 @@ void wright::capacity::wait_until_all_done(boost::asio::yield_context yield) {
 
 void wright::capacity::close() {
     connection::close_all();
+    if (plugins) plugins->close();
     for (auto &child : pool.children) {
         child.stdin.close();
-        waitpid(child.pid, nullptr, 0);
+        if (child.pid > 0) waitpid(child.pid, nullptr, 0);
     }
 }
@@ -10,14 +10,22 @@
 #include <wright/exception.hpp>
 #include <wright/exec.capacity.hpp>
 #include <wright/exec.childproc.hpp>
+#include <wright/exec.zygote.hpp>
 
 #include <fost/log>
 
 #include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <future>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include <signal.h>
+#include <spawn.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -30,22 +38,106 @@ namespace {
 
     fostlib::performance p_crashes(wright::c_exec_helper, "child", "crashed");
     fostlib::performance p_resent(wright::c_exec_helper, "jobs", "resent");
+    fostlib::performance
+            p_out_of_step(wright::c_exec_helper, "child", "out-of-step");
+
+
+    /// The descriptor the process supervisor is given for the resend pipe
+    constexpr int resend_fileno = 3;
+
+
+    /// The worker that the process supervisor kills on `SIGUSR1`
+    volatile sig_atomic_t g_worker = 0;
+    void kill_worker(int) {
+        if (g_worker > 0) ::kill(g_worker, SIGKILL);
+    }
+    sigset_t resync_signal() {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGUSR2);
+        return signals;
+    }
+
+
+    /// The queue depth a child starts with
+    std::size_t initial_depth(std::size_t concurrency, std::size_t most) {
+        return std::clamp(
+                std::max(wright::buffer_size, concurrency),
+                std::min(
+                        std::max(
+                                wright::c_queue_depth_min.value(),
+                                concurrency),
+                        most),
+                most);
+    }
+
+
+    /// The command line for the worker. Workers are told on their command
+    /// line when they must use the framed protocol
+    std::vector<fostlib::string> worker_command() {
+        std::vector<fostlib::string> args;
+        args.reserve(wright::c_exec.value().size() + 2u);
+        for (const auto &item : wright::c_exec.value()) {
+            args.push_back(fostlib::coerce<fostlib::string>(item));
+        }
+        if (wright::c_framed.value()) {
+            args.push_back("--framed");
+            args.push_back("true");
+        }
+        return args;
+    }
 
 
 }
 
 
+void wright::child_signals::install() {
+    struct sigaction sa;
+    sigemptyset(&sa.sa_mask);
+    /// The supervisor is usually waiting for its worker to exit
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = kill_worker;
+    if (::sigaction(SIGUSR1, &sa, nullptr) < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+    /// Blocked so that it is kept until `await_resync` is ready for it
+    const auto resync = resync_signal();
+    if (::sigprocmask(SIG_BLOCK, &resync, nullptr) < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+}
+
+
+void wright::child_signals::worker(int pid) { g_worker = pid; }
+
+
+void wright::child_signals::reset() {
+    ::signal(SIGUSR1, SIG_DFL);
+    const auto resync = resync_signal();
+    ::sigprocmask(SIG_UNBLOCK, &resync, nullptr);
+}
+
+
+void wright::child_signals::await_resync() {
+    const auto resync = resync_signal();
+    int received{};
+    while (::sigwait(&resync, &received) != 0)
+        ;
+}
+
+
 void wright::fork_worker() {
     /// Read in the command line we're going to run
-    std::vector<fostlib::string> argvs;
-    argvs.reserve(c_exec.value().size());
+    auto argvs = worker_command();
     std::vector<char const *> argv;
-    for (const auto &item : c_exec.value()) {
-        auto str = fostlib::coerce<fostlib::string>(item);
-        argv.push_back(str.shrink_to_fit());
-        argvs.push_back(str);
-    }
+    for (auto &arg : argvs) argv.push_back(arg.shrink_to_fit());
     argv.push_back(nullptr);
+    child_signals::install();
+    /// A zygote restarts crashed workers by forking rather than execing
+    if (c_zygote.value()) {
+        zygote_worker(argv);
+        return;
+    }
     /// Fork and loop until done
     while (true) {
         int pid = ::fork();
@@ -55,6 +147,7 @@ void wright::fork_worker() {
             fostlib::log::flush();
             std::exit(5);
         } else if (pid == 0) {
+            child_signals::reset();
             ::execvp(argv.front(), const_cast<char *const *>(argv.data()));
             std::cerr << "Child process failed to start:";
             for (auto part : argv)
@@ -66,9 +159,14 @@ void wright::fork_worker() {
         } else {
             fostlib::log::info(c_exec_helper)("", "Started child process")(
                     "pid", pid)("resend-fd", wright::c_resend_fd.value());
+            /// Tell the manager it can start sending us work
+            const char started[] = "s";
+            ::write(wright::c_resend_fd.value(), started, 1u);
+            child_signals::worker(pid);
             int status;
             waitpid(pid, &status, 0);
-            if (WEXITSTATUS(status) == 0) {
+            child_signals::worker(0);
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
                 fostlib::log::info(c_exec_helper)("", "Child completed")(
                         "pid", pid);
                 return;
@@ -80,6 +178,10 @@ void wright::fork_worker() {
             /// Write a single byte into the pipe
             const char resend[] = "r";
             ::write(wright::c_resend_fd.value(), resend, 1u);
+            /// A framed job only partly read by the dead worker would
+            /// leave the new one out of step with the records. The manager
+            /// throws it away and then tells us to carry on
+            if (c_framed.value()) child_signals::await_resync();
         }
     }
 }
@@ -105,8 +207,18 @@ wright::childproc::childproc(std::size_t n, const char *command)
 : number(n),
   counters(new counter_store{n}),
   argx(fostlib::json::unparse(c_exec.value(), false)),
-  backchannel_fd(std::to_string(::dup(resend.child()))),
-  commands(buffer_size) {
+  concurrency(std::max<std::size_t>(c_worker_concurrency.value(), 1u)),
+  commands(std::max({c_queue_depth_max.value(), buffer_size, concurrency})),
+  depth(initial_depth(concurrency, commands.capacity())) {
+    if (c_direct_supervision.value()) {
+        /// The worker is run directly
+        argvs = worker_command();
+        for (auto &arg : argvs) argv.push_back(arg.shrink_to_fit());
+        argv.push_back(nullptr);
+        return;
+    }
+    resend.emplace();
+    backchannel_fd = std::to_string(resend_fileno);
     argv.push_back(command);
     argv.push_back("--child");
     argv.push_back(counters->reference.name()); // child number
@@ -114,6 +226,14 @@ wright::childproc::childproc(std::size_t n, const char *command)
     argv.push_back("false");
     argv.push_back("-rfd"); // Rsend FD number
     argv.push_back(backchannel_fd.c_str()); // holder for the FD number
+    if (c_zygote.value()) {
+        argv.push_back("--zygote"); // Start the worker as a zygote
+        argv.push_back("true");
+    }
+    if (c_framed.value()) {
+        argv.push_back("--framed"); // Worker uses the framed protocol
+        argv.push_back("true");
+    }
     argv.push_back("-x"); // Program arguments
     argv.push_back(argx.shrink_to_fit());
     argv.push_back(nullptr);
@@ -127,9 +247,42 @@ wright::childproc::childproc(childproc &&p)
   resend(std::move(p.resend)),
   number(p.number),
   counters(std::move(p.counters)),
+  argvs(std::move(p.argvs)),
   argv(std::move(p.argv)),
   pid(p.pid),
-  commands(std::move(p.commands)) {}
+  ready(p.ready),
+  retiring(p.retiring),
+  idle_intervals(p.idle_intervals),
+  serving(p.serving.load()),
+  concurrency(p.concurrency),
+  writing(p.writing),
+  generation(p.generation),
+  commands(std::move(p.commands)),
+  next_sequence(p.next_sequence),
+  depth(p.depth),
+  mean_time(p.mean_time) {}
+
+
+int64_t wright::childproc::record_time(double seconds) {
+    /// A worker running several jobs at once gets through them that much
+    /// faster
+    seconds /= concurrency;
+    mean_time = mean_time ? 0.8 * mean_time + 0.2 * seconds : seconds;
+    /// Queue enough jobs to cover the target time, but never so many
+    /// that another worker would be left idle on a long job
+    const double target = c_queue_target.value() / 1000.0;
+    const std::size_t wanted = mean_time > 0
+            ? std::ceil(target / mean_time)
+            : commands.capacity();
+    const auto old_depth = depth;
+    depth = std::clamp(
+            wanted,
+            std::min(
+                    std::max(c_queue_depth_min.value(), concurrency),
+                    commands.capacity()),
+            commands.capacity());
+    return int64_t(depth) - int64_t(old_depth);
+}
 
 
 namespace {
@@ -142,12 +295,28 @@ namespace {
 
 void wright::childproc::write(
         boost::asio::io_service &ios,
-        const std::string &command,
+        const job &work,
         boost::asio::yield_context yield) {
-    std::array<boost::asio::streambuf::const_buffers_type, 2> buffer{
-            {{command.data(), command.size()}, newline.buffer.data()}};
+    boost::asio::steady_timer turn{ios};
+    while (writing) {
+        turn.expires_from_now(1ms);
+        turn.async_wait(yield);
+    }
     boost::system::error_code error;
-    boost::asio::async_write(stdin.parent(ios), buffer, yield[error]);
+    ++writing;
+    if (c_framed.value()) {
+        const auto header = frame_header(work.sequence, work.command.size());
+        std::array<boost::asio::const_buffer, 2> buffer{
+                {{header.data(), header.size()},
+                 {work.command.data(), work.command.size()}}};
+        boost::asio::async_write(stdin.parent(ios), buffer, yield[error]);
+    } else {
+        std::array<boost::asio::streambuf::const_buffers_type, 2> buffer{
+                {{work.command.data(), work.command.size()},
+                 newline.buffer.data()}};
+        boost::asio::async_write(stdin.parent(ios), buffer, yield[error]);
+    }
+    --writing;
     if (error) {
         fostlib::log::critical(counters->reference)(
                 "", "Error writing to pipe for child")("error", error);
@@ -159,37 +328,60 @@ void wright::childproc::write(
 
 std::string wright::childproc::read(
         boost::asio::io_service &ios,
-        boost::asio::streambuf &buffer,
+        line_reader &lines,
         boost::asio::yield_context yield) {
-    boost::system::error_code error;
-    auto bytes = boost::asio::async_read_until(
-            stdout.parent(ios), buffer, '\n', yield[error]);
-    if (error) {
-        std::cerr << pid << " read error: " << error << std::endl;
-    } else if (bytes) {
-        /// For some reason I totally fail to understand we can actually
-        /// end up reading a sequence of zero byte values at the start
-        /// of the line. These need to be filtered out as they appear to
-        /// be totally spurious. They fail the string comparison when we
-        /// check if the line read matches the job we sent.
-        ///
-        /// At least that can happen if we give the buffer to a
-        /// `std::istream`. It doesn't seem to happen when pulling the
-        /// characters off one at a time.
-        std::string line;
-        line.reserve(bytes);
-        for (; bytes; --bytes) {
-            char next = buffer.sbumpc();
-            if (next == 0 || next == '\n') {
-                //                 std::cerr << pid << " dropped " << int(next)
-                //                 << std::endl;
-            } else {
-                line += next;
-            }
+    while (true) {
+        if (auto line = lines.next(); line) { return std::string(*line); }
+        boost::system::error_code error;
+        lines.fill(stdout.parent(ios), yield[error]);
+        if (error) {
+            std::cerr << pid << " read error: " << error << std::endl;
+            return std::string();
+        }
+    }
+}
+
+
+std::optional<std::size_t>
+        wright::childproc::find_job(std::string_view result) const {
+    const auto running = concurrency > 1u ? commands.size() : 1u;
+    for (std::size_t index{}; index < std::min(running, commands.size());
+         ++index) {
+        if (commands[index].command == result) return index;
+    }
+    return {};
+}
+std::optional<std::size_t>
+        wright::childproc::find_job(uint64_t sequence) const {
+    const auto running = concurrency > 1u ? commands.size() : 1u;
+    for (std::size_t index{}; index < std::min(running, commands.size());
+         ++index) {
+        if (commands[index].sequence == sequence) return index;
+    }
+    return {};
+}
+
+
+std::optional<wright::frame> wright::childproc::read_frame(
+        boost::asio::io_service &ios,
+        line_reader &lines,
+        boost::asio::yield_context yield) {
+    while (true) {
+        if (auto record = lines.next_frame(); record) { return record; }
+        const auto started = generation;
+        boost::system::error_code error;
+        lines.fill(stdout.parent(ios), yield[error]);
+        if (generation != started) {
+            /// The worker was replaced whilst we were waiting, so what we
+            /// have is from the old one. A record that straddles the
+            /// restart must not be used either
+            lines.remainder();
+            continue;
+        } else if (error) {
+            std::cerr << pid << " read error: " << error << std::endl;
+            return {};
         }
-        return line;
     }
-    return std::string();
 }
 
 
@@ -199,9 +391,9 @@ void wright::childproc::handle_child_requests(
         boost::asio::yield_context yield) {
     boost::asio::streambuf buffer;
     boost::system::error_code error;
-    while (resend.parent(ctrlios).is_open()) {
+    while (resend && resend->parent(ctrlios).is_open()) {
         auto bytes = boost::asio::async_read(
-                resend.parent(ctrlios), buffer,
+                resend->parent(ctrlios), buffer,
                 boost::asio::transfer_exactly(1), yield[error]);
         if (bytes && not error) {
             switch (char byte = buffer.sbumpc()) {
@@ -221,18 +413,14 @@ void wright::childproc::handle_child_requests(
                     /// to be looping in an error. Kill it
                     ::kill(pid, SIGTERM);
                 } else {
-                    auto logger = fostlib::log::debug(counters->reference);
-                    logger("", "Resending jobs for child")("child", pid)(
-                            "job", "count", commands.size());
-                    fostlib::json jobs;
-                    for (auto &job : commands) {
-                        fostlib::push_back(jobs, job.command);
-                        write(ctrlios, job.command, yield);
-                        ++p_resent;
+                    if (c_framed.value()) {
+                        resync(ctrlios, yield);
+                        ::kill(pid, SIGUSR2);
                     }
-                    if (jobs.size()) logger("job", "list", jobs);
+                    resend_jobs(ctrlios, yield);
                 }
                 break;
+            case 's': cap.child_ready(*this); break;
             case 'x': {
                 fostlib::log::critical(
                         counters->reference,
@@ -243,7 +431,7 @@ void wright::childproc::handle_child_requests(
             case '{': {
                 fostlib::string jsonstr{"{"};
                 auto bytes = boost::asio::async_read_until(
-                        resend.parent(ctrlios), buffer, 0, yield[error]);
+                        resend->parent(ctrlios), buffer, 0, yield[error]);
                 if (not error) {
                     for (; bytes; --bytes) {
                         char next = buffer.sbumpc();
@@ -263,6 +451,9 @@ void wright::childproc::handle_child_requests(
                 break;
             }
             }
+        } else if (retiring) {
+            /// The process supervisor exits once its worker has finished
+            return;
         } else {
             fostlib::log::critical(c_exec_helper)(
                     "", "Error reading from child pipe")("error", error)(
@@ -274,6 +465,122 @@ void wright::childproc::handle_child_requests(
 }
 
 
+void wright::childproc::resync(
+        boost::asio::io_service &ctrlios, boost::asio::yield_context yield) {
+    /// Nothing reads the pipe until the new worker starts, so a write that
+    /// is bigger than the pipe buffer only finishes if we keep emptying it
+    boost::asio::steady_timer wait{ctrlios};
+    /// Once stdin has been closed there is nothing to throw away
+    while (stdin.child()) {
+        detail::discard(stdin.child());
+        if (not writing) break;
+        wait.expires_from_now(1ms);
+        wait.async_wait(yield);
+    }
+    /// The old worker has gone, so everything in its stdout is from it.
+    /// The read in progress is cancelled so that `read_frame` sees the
+    /// generation change and drops what it has already read
+    auto &output = stdout.parent(ctrlios);
+    if (output.is_open()) {
+        detail::discard(output.native_handle());
+        output.cancel();
+    }
+    ++generation;
+}
+
+
+void wright::childproc::resend_jobs(
+        boost::asio::io_service &ctrlios, boost::asio::yield_context yield) {
+    auto logger = fostlib::log::debug(counters->reference);
+    logger("", "Resending jobs for child")("child", pid)(
+            "job", "count", commands.size());
+    fostlib::json jobs;
+    /// Jobs can finish, and leave the queue, whilst we're writing. So we go
+    /// by sequence number and write a copy of each job that is still there
+    std::vector<uint64_t> sequences;
+    sequences.reserve(commands.size());
+    for (auto const &job : commands) sequences.push_back(job.sequence);
+    for (auto const sequence : sequences) {
+        auto const pos = std::find_if(
+                commands.begin(), commands.end(),
+                [sequence](auto const &j) { return j.sequence == sequence; });
+        if (pos == commands.end()) continue;
+        const job work{pos->command, {}, {}, pos->id, sequence};
+        fostlib::push_back(jobs, work.command);
+        write(ctrlios, work, yield);
+        ++p_resent;
+    }
+    if (jobs.size()) logger("job", "list", jobs);
+}
+
+
+std::shared_ptr<void> wright::childproc::in_use() {
+    ++serving;
+    return std::shared_ptr<void>(
+            this, [](void *cp) { --static_cast<childproc *>(cp)->serving; });
+}
+
+
+void wright::childproc::renew() {
+    stdin = pipe_in{};
+    stdout = pipe_out{};
+    stderr = pipe_out{};
+    if (resend) resend.emplace();
+    pid = 0;
+    ready = false;
+    retiring = false;
+    idle_intervals = 0;
+    commands.clear();
+    depth = initial_depth(concurrency, commands.capacity());
+    mean_time = 0;
+}
+
+
+void wright::childproc::spawn() {
+    posix_spawn_file_actions_t actions;
+    if (int error = ::posix_spawn_file_actions_init(&actions); error) {
+        throw std::system_error(error, std::system_category());
+    }
+    ::posix_spawn_file_actions_adddup2(&actions, stdin.child(), STDIN_FILENO);
+    ::posix_spawn_file_actions_adddup2(
+            &actions, stdout.child(), STDOUT_FILENO);
+    ::posix_spawn_file_actions_adddup2(
+            &actions, stderr.child(), STDERR_FILENO);
+    if (resend) {
+        ::posix_spawn_file_actions_adddup2(
+                &actions, resend->child(), resend_fileno);
+    }
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 34)
+    /// Descriptors opened by libraries may not be close on exec
+    ::posix_spawn_file_actions_addclosefrom_np(
+            &actions, resend ? resend_fileno + 1 : STDERR_FILENO + 1);
+#endif
+    const int error = ::posix_spawnp(
+            &pid, argv.front(), &actions, nullptr,
+            const_cast<char *const *>(argv.data()), environ);
+    ::posix_spawn_file_actions_destroy(&actions);
+    if (error) { throw std::system_error(error, std::system_category()); }
+}
+
+
+void wright::childproc::restart(
+        boost::asio::io_service &ctrlios, boost::asio::yield_context yield) {
+    /// Throw away any part of a framed job the dead worker didn't read
+    if (c_framed.value()) resync(ctrlios, yield);
+    try {
+        spawn();
+    } catch (std::system_error &e) {
+        fostlib::log::critical(counters->reference)(
+                "", "Could not start worker process")("error", e.what());
+        fostlib::log::flush();
+        std::exit(10);
+    }
+    fostlib::log::info(counters->reference)("", "Restarted worker")(
+            "pid", pid);
+    resend_jobs(ctrlios, yield);
+}
+
+
 void wright::childproc::drain_stderr(
         boost::asio::io_service &auxios, boost::asio::yield_context yield) {
     boost::asio::streambuf buffer;
@@ -305,21 +612,72 @@ void wright::childproc::handle_stdout(
         boost::asio::io_service &ctrlios,
         boost::asio::yield_context yield,
         child_pool &pool,
-        std::function<void(const std::string &)> job_done) {
-    boost::asio::streambuf buffer;
+        std::function<void(const job &)> job_done) {
+    line_reader lines;
+    /// Retire a job from the queue
+    auto complete = [&](std::size_t index) {
+        //             ++(counters->completed);
+        auto done = std::move(commands[index]);
+        commands.erase(commands.begin() + index);
+        pool.job_times.record(done.time);
+        /// The job that has just moved up into the ones the worker is
+        /// running starts its timer now
+        if (index < concurrency && commands.size() >= concurrency) {
+            commands[concurrency - 1u].time.reset();
+        }
+        job_done(done);
+    };
+    /// The worker's output can't be read any more, so throw away what we
+    /// have of it and have the worker restarted. Its jobs are then resent
+    auto out_of_step = [&](const char *why) {
+        ++p_out_of_step;
+        fostlib::log::error(counters->reference)(
+                "", "Worker output is out of step -- restarting worker")(
+                "pid", pid)("reason", why);
+        lines.remainder();
+        if (pid > 0) {
+            ::kill(pid, c_direct_supervision.value() ? SIGKILL : SIGUSR1);
+        }
+    };
     while (stdout.parent(ctrlios).is_open()) {
+        if (c_framed.value()) {
+            std::optional<frame> record;
+            try {
+                record = read_frame(ctrlios, lines, yield);
+            } catch (frame_error &e) {
+                out_of_step(e.what());
+                continue;
+            }
+            if (not record) {
+                continue;
+            } else if (auto index = find_job(record->id); index) {
+                fostlib::log::debug(c_exec_helper)(
+                        "", "Got result from child")("child", pid)(
+                        "id", record->id);
+                if (c_results.value()) {
+                    commands[*index].result = std::string(record->payload);
+                }
+                complete(*index);
+            } else if (record->id >= next_sequence) {
+                out_of_step("Record is for a job that was never sent");
+            } else {
+                /// A job that was resent can be finished twice
+                fostlib::log::debug(c_exec_helper)(
+                        "", "Ignored record from child")("id", record->id)(
+                        "size", record->payload.size())(
+                        "expected", commands.size()
+                                ? fostlib::json(commands.front().sequence)
+                                : fostlib::json());
+            }
+            continue;
+        }
         boost::system::error_code error;
-        auto ret = read(ctrlios, buffer, yield[error]);
-        if (not error && not ret.empty() && commands.size()
-            && ret == commands.front().command) {
-            //             ++(counters->completed);
-            pool.job_times.record(commands.front().time);
-            commands.pop_front();
-            if (commands.size()) commands.front().time.reset();
+        auto ret = read(ctrlios, lines, yield[error]);
+        if (auto index = find_job(ret); not error && not ret.empty() && index) {
             auto logger = fostlib::log::debug(c_exec_helper);
             logger("", "Got result from child")("child", pid)(
                     "result", ret.c_str());
-            job_done(ret);
+            complete(*index);
         } else if (error) {
             fostlib::log::warning(c_exec_helper)(
                     "", "Read error from child stdout")("child", pid)(
@@ -351,7 +709,7 @@ void wright::childproc::close() {
     stdin.close();
     stdout.close();
     stderr.close();
-    resend.close();
+    if (resend) resend->close();
 }
 
 
@@ -381,14 +739,58 @@ namespace {
                     __func__, "Failed to establish signal handler for SIGCHLD");
         }
     }
+    /// Deal with the death of a worker that the manager runs directly
+    void worker_died(
+            boost::asio::io_service &ctrlios,
+            wright::capacity &cap,
+            wright::childproc &child,
+            int status) {
+        if ((cap.input_complete.load() && child.commands.empty())
+                || not child.stdin.child()) {
+            /// Either all of the work is done, or we're shutting down and
+            /// have already closed the worker's stdin
+            fostlib::log::info(child.counters->reference)(
+                    "", "Worker finished")("pid", child.pid)(
+                    "status", status);
+        } else {
+            ++p_crashes;
+            fostlib::log::warning(child.counters->reference)(
+                    "", "Worker died -- restarting")("pid", child.pid)(
+                    "status", status)("job", "count", child.commands.size());
+            /// Restarting waits for the worker's stdin to be cleared and
+            /// its jobs to be resent, which mustn't hold up reaping the
+            /// other children
+            boost::asio::spawn(
+                    ctrlios,
+                    wright::exception_decorator(
+                            [&ctrlios, &child](auto yield) {
+                                child.restart(ctrlios, yield);
+                            },
+                            wright::exit_on_error));
+        }
+    }
+    /// A child that was asked to exit so that the pool could shrink has
+    /// done so
+    void child_retired(wright::childproc &child, int status) {
+        fostlib::log::info(child.counters->reference)("", "Child retired")(
+                "pid", child.pid)("status", status);
+        child.pid = 0;
+        child.stdout.close();
+        if (child.resend) child.resend->close();
+        /// stderr is read on the auxiliary reactor, which stops when it
+        /// sees the end of the file
+        child.stderr.close_child();
+    }
     auto sigchild_reactor(
-            boost::asio::io_service &auxios, wright::child_pool &pool) {
+            boost::asio::io_service &ctrlios,
+            wright::child_pool &pool,
+            wright::capacity &cap) {
         return [&](auto yield) {
             boost::asio::streambuf buffer;
             boost::system::error_code error;
-            while (sigchild->parent(auxios).is_open()) {
+            while (sigchild->parent(ctrlios).is_open()) {
                 const auto bytes = boost::asio::async_read(
-                        sigchild->parent(auxios), buffer,
+                        sigchild->parent(ctrlios), buffer,
                         boost::asio::transfer_exactly(1), yield[error]);
                 if (bytes && not error) {
                     for (auto remaining{bytes}; remaining; --remaining) {
@@ -398,11 +800,25 @@ namespace {
                                       << std::endl;
                             break;
                         case 'c':
-                            for (auto &child : pool.children) {
+                            /// The pool can grow while a restart is under
+                            /// way, so go by index
+                            for (std::size_t index{};
+                                 index < pool.children.size(); ++index) {
+                                auto &child = pool.children[index];
                                 int status{};
+                                /// A retired child's PID may have been
+                                /// given to a new process
+                                if (child.pid <= 0) continue;
                                 if (child.pid
                                     == waitpid(child.pid, &status, WNOHANG)) {
-                                    if (child.commands.empty()) {
+                                    if (child.retiring
+                                        && not child.stdin.child()) {
+                                        child_retired(child, status);
+                                    } else if (wright::c_direct_supervision
+                                                       .value()) {
+                                        worker_died(
+                                                ctrlios, cap, child, status);
+                                    } else if (child.commands.empty()) {
                                         fostlib::log::warning(
                                                 child.counters->reference)(
                                                 "",
@@ -468,14 +884,41 @@ namespace {
 
 
 wright::child_pool::child_pool(std::size_t number, const char *command)
-: job_times(5ms, 1.2, 200, 24ms) {
-    children.reserve(number);
-    /// For each child go through and fork and execvp it
+: command(command), job_times(5ms, 1.2, 200, 24ms) {
+    if (c_results.value() && not c_framed.value() && not c_plugin.value()) {
+        throw fostlib::exceptions::not_implemented(
+                __func__,
+                "Capturing results from worker processes needs the framed "
+                "protocol (--framed true)");
+    }
+    if (c_direct_supervision.value() && c_zygote.value()) {
+        fostlib::log::warning(
+                c_exec_helper,
+                "Zygote workers need a process supervisor, so zygote mode is "
+                "ignored when the workers are supervised directly");
+    }
     for (std::size_t child{}; child < number; ++child) {
         children.emplace_back(child + 1, command);
-        children[child].fork_exec([&]() {
-            for (auto &child : children) { child.close(); }
-        });
+    }
+    /// Spawn the children from several threads so that large pools come
+    /// up quickly. Each thread starts every n'th child
+    const std::size_t threads = std::min<std::size_t>(
+            number, std::max(std::thread::hardware_concurrency(), 1u));
+    std::vector<std::future<void>> spawning;
+    for (std::size_t thread{}; thread < threads; ++thread) {
+        spawning.push_back(
+                std::async(std::launch::async, [this, thread, threads]() {
+                    for (auto child{thread}; child < children.size();
+                         child += threads) {
+                        children[child].spawn();
+                    }
+                }));
+    }
+    for (auto &spawned : spawning) spawned.get();
+    /// Without a process supervisor there is nobody to tell us when the
+    /// worker has started, but it has its stdin now so can be given work
+    if (c_direct_supervision.value()) {
+        for (auto &child : children) child.ready = true;
     }
     /// Now that we have children, we're going to want to deal with
     /// their deaths
@@ -483,7 +926,31 @@ wright::child_pool::child_pool(std::size_t number, const char *command)
     attach_sigchild_handler();
 }
 
-void wright::child_pool::sigchild_handling(boost::asio::io_service &ios) {
+wright::childproc &wright::child_pool::add() {
+    for (auto &child : children) {
+        if (child.retiring && child.pid == 0 && not child.serving.load()) {
+            child.renew();
+            child.spawn();
+            return child;
+        }
+    }
+    auto &child = children.emplace_back(children.size() + 1u, command);
+    child.spawn();
+    return child;
+}
+
+
+std::size_t wright::child_pool::active() const {
+    return std::count_if(
+            children.begin(), children.end(),
+            [](auto const &child) { return not child.retiring; });
+}
+
+
+void wright::child_pool::sigchild_handling(
+        boost::asio::io_service &ctrlios, capacity &cap) {
     /// Process the other end of the signal handler pipe
-    boost::asio::spawn(ios, exception_decorator(sigchild_reactor(ios, *this)));
+    boost::asio::spawn(
+            ctrlios,
+            exception_decorator(sigchild_reactor(ctrlios, *this, cap)));
 }
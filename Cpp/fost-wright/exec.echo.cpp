@@ -8,6 +8,8 @@
 
 #include <wright/configuration.hpp>
 #include <wright/exec.hpp>
+#include <wright/exec.zygote.hpp>
+#include <wright/frame.hpp>
 
 #include <fost/timer>
 
@@ -22,6 +24,10 @@ using namespace std::chrono_literals;
 
 
 void wright::echo(std::istream &in, std::ostream &out, std::ostream &report) {
+    /// Each simulated worker is forked from here when running as a zygote,
+    /// so this must happen before the random number generator is seeded
+    zygote();
+
     bool first = true;
     fostlib::timer time;
     fostlib::time_profile<std::chrono::microseconds> times(5us, 1.2, 5);
@@ -31,10 +37,13 @@ void wright::echo(std::istream &in, std::ostream &out, std::ostream &report) {
     std::normal_distribution<float> rand(c_sim_mean.value(), c_sim_sd.value());
     const auto crash_limit = c_sim_mean.value() + c_sim_sd.value();
 
+    const bool framed = c_framed.value();
     std::string command;
+    uint64_t id{};
     while (in) {
-        std::getline(in, command);
-        if (in && not command.empty()) {
+        const bool got = framed ? read_frame(in, id, command)
+                                : bool(std::getline(in, command));
+        if (got && (framed || not command.empty())) {
             if (not first) times.record(time);
             first = false;
             std::this_thread::sleep_for(rand(gen) * 1ms);
@@ -43,10 +52,18 @@ void wright::echo(std::istream &in, std::ostream &out, std::ostream &report) {
                 exit(3); // Simulate a crash
             }
             time.reset();
-            out << command << std::endl;
+            if (framed) {
+                write_frame(out, id, command);
+            } else {
+                out << command << std::endl;
+            }
         }
         if (rand(gen) > crash_limit && c_can_die.value()) {
-            out << "Uh oh, crashed" << std::endl;
+            if (framed) {
+                write_frame(out, ~uint64_t{}, "Uh oh, crashed");
+            } else {
+                out << "Uh oh, crashed" << std::endl;
+            }
             report << "Crash after work... " << ::getpid() << std::endl;
             exit(2); // Simulate a crash
         }
@@ -0,0 +1,76 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/exec.input.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+wright::mapped_input::mapped_input(int fd) {
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+    size = st.st_size;
+    /// An empty file can't be mapped, but then there are no jobs anyway
+    if (size) {
+        auto mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::system_error(errno, std::system_category());
+        }
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        base = static_cast<const char *>(mapping);
+    }
+}
+
+
+wright::mapped_input::~mapped_input() {
+    if (base) ::munmap(const_cast<char *>(base), size);
+}
+
+
+std::optional<wright::mapped_input> wright::mapped_input::if_regular(int fd) {
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || not S_ISREG(st.st_mode)) return {};
+    return std::make_optional<mapped_input>(fd);
+}
+
+
+std::size_t wright::mapped_input::count() const {
+    std::size_t lines{};
+    for (auto p = base, end = base + size; p < end; ++lines) {
+        auto const nl =
+                static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (not nl) break;
+        p = nl + 1;
+    }
+    /// A final line doesn't need a newline
+    if (size && base[size - 1] != '\n') ++lines;
+    return lines;
+}
+
+
+std::optional<std::string> wright::mapped_input::next() {
+    if (position >= size) return {};
+    auto const start = base + position;
+    auto const remaining = size - position;
+    auto const nl =
+            static_cast<const char *>(std::memchr(start, '\n', remaining));
+    const std::size_t length = nl ? nl - start : remaining;
+    position += nl ? length + 1u : length;
+    std::string line(start, length);
+    if (std::memchr(line.data(), 0, line.size())) {
+        line.erase(std::remove(line.begin(), line.end(), '\0'), line.end());
+    }
+    return line;
+}
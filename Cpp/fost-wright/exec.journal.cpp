@@ -0,0 +1,157 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/configuration.hpp>
+#include <wright/exec.journal.hpp>
+
+#include <fost/counter>
+#include <fost/log>
+
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace {
+
+
+    fostlib::performance
+            p_commits(wright::c_exec_helper, "journal", "commits");
+    fostlib::performance
+            p_records(wright::c_exec_helper, "journal", "records");
+    fostlib::performance
+            p_skipped(wright::c_exec_helper, "journal", "skipped");
+
+
+}
+
+
+wright::journal::journal(std::string fn, bool resume)
+: filename(std::move(fn)) {
+    fd = ::open(
+            filename.c_str(),
+            O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC | (resume ? 0 : O_TRUNC),
+            0644);
+    if (fd < 0) throw std::system_error(errno, std::system_category());
+    if (resume) replay();
+    writer = std::thread([this]() { write_loop(); });
+}
+
+
+void wright::journal::replay() {
+    std::size_t accepted{}, completed{}, bytes{};
+    std::vector<record> block(4096u);
+    while (true) {
+        auto const got = ::read(
+                fd, block.data(), block.size() * sizeof(record));
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::system_category());
+        } else if (got == 0) {
+            break;
+        }
+        /// A short read will leave a partial record at the end, which
+        /// can only happen if the previous run died part way through a
+        /// write. It is dropped by the truncate below.
+        for (std::size_t index{}; index < got / sizeof(record); ++index) {
+            auto const &r = block[index];
+            if (r.kind == 'c') {
+                ++done[r.key];
+                ++completed;
+            } else {
+                ++accepted;
+            }
+        }
+        bytes += (got / sizeof(record)) * sizeof(record);
+        if (got % sizeof(record)) break;
+    }
+    if (::ftruncate(fd, bytes) < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+    fostlib::log::warning(c_exec_helper)("", "Journal replayed")(
+            "filename", filename.c_str())("accepted", accepted)(
+            "completed", completed)("in-flight", accepted - completed);
+}
+
+
+bool wright::journal::completed_before(std::string_view job) {
+    if (done.empty()) return false;
+    auto pos = done.find(job_key::make(job));
+    if (pos == done.end()) return false;
+    if (--pos->second == 0u) done.erase(pos);
+    ++p_skipped;
+    return true;
+}
+
+
+void wright::journal::add(uint64_t kind, job_key key, std::size_t times) {
+    const record r{kind, key};
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (; times; --times) pending.push_back(r);
+    }
+    signal.notify_one();
+}
+
+
+void wright::journal::close() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (closing) return;
+        closing = true;
+    }
+    signal.notify_one();
+    if (writer.joinable()) writer.join();
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+
+void wright::journal::write_loop() {
+    const std::chrono::milliseconds interval{c_journal_commit_interval.value()};
+    std::vector<record> commit;
+    bool finished = false;
+    while (not finished) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            signal.wait(lock, [this]() { return closing || pending.size(); });
+            commit.swap(pending);
+            finished = closing;
+        }
+        auto const *data = reinterpret_cast<const char *>(commit.data());
+        std::size_t remaining = commit.size() * sizeof(record);
+        while (remaining) {
+            auto const written = ::write(fd, data, remaining);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                fostlib::log::critical(c_exec_helper)(
+                        "", "Error writing to journal")("errno", errno);
+                fostlib::log::flush();
+                std::exit(13);
+            }
+            data += written;
+            remaining -= written;
+        }
+        if (commit.size()) {
+            while (::fdatasync(fd) < 0) {
+                if (errno == EINTR) continue;
+                fostlib::log::critical(c_exec_helper)(
+                        "", "Error syncing the journal")("errno", errno);
+                fostlib::log::flush();
+                std::exit(13);
+            }
+            ++p_commits;
+            p_records += commit.size();
+        }
+        commit.clear();
+        /// Give more records a chance to arrive so that they can share
+        /// the next sync
+        if (not finished) std::this_thread::sleep_for(interval);
+    }
+}
@@ -16,11 +16,15 @@
 #include <wright/net.server.hpp>
 
 #include <f5/threading/reactor.hpp>
+#include <fost/unicode>
+
+#include <future>
+#include <thread>
 
 
 void wright::netvisor(const char *command) {
     /// Set up the child worker pool
-    child_pool pool(c_children.value(), command);
+    child_pool pool(c_plugin.value() ? 0 : c_children.value(), command);
 
     /// Stop on exception, one thread. We want one thread here so
     /// we don't have to worry about thread synchronisation when
@@ -36,17 +40,59 @@ void wright::netvisor(const char *command) {
     add_watchdog(ctrlios, auxios);
     add_watchdog(auxios, ctrlios);
 
-    /// Start the child signal processing
-    pool.sigchild_handling(auxios);
     /// Track the worker capacity
     capacity workers{ctrlios, pool};
+    /// Start the child signal processing
+    pool.sigchild_handling(ctrlios, workers);
+    /// Run the jobs in this process if there is a plugin
+    if (c_plugin.value()) {
+        workers.use_plugins(std::make_unique<plugin_pool>(
+                ctrlios,
+                static_cast<std::string>(
+                        fostlib::coerce<fostlib::utf8_string>(
+                                c_plugin.value().value())
+                                .underlying()),
+                c_plugin_threads.value(),
+                [&](const job &done) {
+                    workers.job_done(done.command);
+                    workers.report_upstream(
+                            done.command, done.id, done.result);
+                },
+                [&](const job &failed) {
+                    /// There is no way to tell the server a job failed, and
+                    /// reporting it as done would pass it off as a success
+                    fostlib::log::critical(c_exec_helper)(
+                            "", "Plugin job failed on a networked client")(
+                            "job", failed.command.c_str());
+                    fostlib::log::flush();
+                    std::exit(14);
+                }));
+    }
 
     /// Set up the network connection to the server
-    auto cnx = fostlib::hod::tcp_connect<connection>(
-            fostlib::host{c_connect.value().value(), c_port.value()}, ctrlios,
-            connection::client_side, workers);
-    fostlib::log::info(wright::c_exec_helper)("", "Connection established")(
-            "host", c_connect.value())("port", c_port.value());
+    auto connect = [&]() {
+        auto cnx = fostlib::hod::tcp_connect<connection>(
+                fostlib::host{c_connect.value().value(), c_port.value()},
+                ctrlios, connection::client_side, workers);
+        fostlib::log::info(wright::c_exec_helper)("", "Connection established")(
+                "host", c_connect.value())("port", c_port.value());
+        return cnx;
+    };
+    std::shared_ptr<connection> cnx = connect();
+
+    /// When relaying, our own clients' capacity is added to ours and the
+    /// jobs they complete are passed back up to the server
+    if (c_relay_port.value()) {
+        workers.report = [&](const std::string &job, std::size_t,
+                             std::optional<std::string_view> result,
+                             std::optional<uint64_t> id) {
+            workers.report_upstream(
+                    job, id,
+                    result ? std::make_optional(std::string(*result))
+                           : std::nullopt);
+        };
+        start_server(auxios, ctrlios, c_relay_port.value(), workers);
+    }
 
     /// Go through each child and service them properly
     for (auto &child : pool.children) {
@@ -56,10 +102,11 @@ void wright::netvisor(const char *command) {
         boost::asio::spawn(ctrlios, exception_decorator([&, cp](auto yield) {
                                cp->handle_stdout(
                                        ctrlios, yield, workers.pool,
-                                       [&](const std::string &job) {
-                                           workers.job_done(job);
-                                           cnx->queue.produce(
-                                                   out::completed(job));
+                                       [&](const job &done) {
+                                           workers.job_done(*cp, done);
+                                           workers.report_upstream(
+                                                   done.command, done.id,
+                                                   done.result);
                                        });
                            }));
         /// We also need to watch for a resend alert from the child process
@@ -84,8 +131,33 @@ void wright::netvisor(const char *command) {
                            }
                        }));
 
-    /// Wait for the connetion to end...
-    cnx->wait_for_close();
+    /// Wait for the connetion to end. If it is lost while the server is
+    /// still waiting to hear about some of our jobs then we try to get it
+    /// back, and our session with it, within the grace period
+    while (true) {
+        cnx->wait_for_close();
+        if (cnx->version() < 7u || not c_session_grace.value()) break;
+        std::promise<bool> owed;
+        ctrlios.post([&]() { owed.set_value(workers.owes_upstream()); });
+        if (not owed.get_future().get()) break;
+        fostlib::log::warning(c_exec_helper)(
+                "", "Lost connection to server -- reconnecting")(
+                "grace", c_session_grace.value());
+        std::shared_ptr<connection> next;
+        for (fostlib::timer lost;
+             not next && lost.seconds() < c_session_grace.value();) {
+            try {
+                next = connect();
+            } catch (std::exception &e) {
+                fostlib::log::warning(c_exec_helper)(
+                        "", "Could not reconnect to server")(
+                        "error", e.what());
+                std::this_thread::sleep_for(std::chrono::seconds{1});
+            }
+        }
+        if (not next) break;
+        cnx = std::move(next);
+    }
 
     /// Terminating. Wait for children
     workers.close();
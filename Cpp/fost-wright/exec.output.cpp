@@ -0,0 +1,99 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/configuration.hpp>
+#include <wright/exec.output.hpp>
+
+#include <fost/counter>
+#include <fost/log>
+
+#include <cerrno>
+
+#include <unistd.h>
+
+
+namespace {
+
+
+    fostlib::performance p_writes(wright::c_exec_helper, "output", "writes");
+    fostlib::performance p_bytes(wright::c_exec_helper, "output", "bytes");
+
+
+}
+
+
+wright::result_writer::result_writer(int f)
+: fd(f), writer([this]() { write_loop(); }) {}
+
+
+void wright::result_writer::write(
+        std::string_view job,
+        std::size_t times,
+        std::function<void()> written) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (written) after_write.push_back(std::move(written));
+    for (; times; --times) {
+        pending.append(job.data(), job.size());
+        pending += '\n';
+    }
+    if (pending.size() >= c_output_flush_size.value()) signal.notify_one();
+}
+
+
+bool wright::result_writer::backed_up() {
+    std::unique_lock<std::mutex> lock(mutex);
+    return pending.size() >= c_output_high_water.value();
+}
+
+
+void wright::result_writer::close() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (closing) return;
+        closing = true;
+    }
+    signal.notify_one();
+    writer.join();
+}
+
+
+void wright::result_writer::write_loop() {
+    const std::chrono::milliseconds interval{c_output_flush_interval.value()};
+    std::string block;
+    std::vector<std::function<void()>> written_block;
+    bool done = false;
+    while (not done) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            signal.wait_for(lock, interval, [this]() {
+                return closing
+                        || pending.size() >= c_output_flush_size.value();
+            });
+            block.swap(pending);
+            written_block.swap(after_write);
+            done = closing;
+        }
+        for (std::size_t written{}; written < block.size();) {
+            auto const bytes = ::write(
+                    fd, block.data() + written, block.size() - written);
+            if (bytes < 0) {
+                if (errno == EINTR) continue;
+                fostlib::log::critical(c_exec_helper)(
+                        "", "Error writing completed jobs")("errno", errno);
+                fostlib::log::flush();
+                std::exit(12);
+            }
+            written += bytes;
+            ++p_writes;
+            p_bytes += bytes;
+        }
+        block.clear();
+        for (auto &written : written_block) written();
+        written_block.clear();
+    }
+}
@@ -0,0 +1,147 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/configuration.hpp>
+#include <wright/exec.plugin.hpp>
+
+#include <fost/counter>
+#include <fost/log>
+
+#include <dlfcn.h>
+
+
+namespace {
+
+
+    fostlib::performance p_run(wright::c_exec_helper, "plugin", "run");
+    fostlib::performance p_failed(wright::c_exec_helper, "plugin", "failed");
+    fostlib::performance
+            p_given_up(wright::c_exec_helper, "plugin", "given-up");
+
+
+    void append_result(void *context, const char *data, size_t length) {
+        static_cast<std::string *>(context)->append(data, length);
+    }
+
+
+}
+
+
+wright::plugin_pool::plugin_pool(
+        boost::asio::io_service &ios,
+        const std::string &filename,
+        std::size_t count,
+        std::function<void(const job &)> d,
+        std::function<void(const job &)> f)
+: ios(ios),
+  library(::dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL)),
+  entry(nullptr),
+  done(std::move(d)),
+  failed(std::move(f)) {
+    if (not library) {
+        throw fostlib::exceptions::not_implemented(
+                __func__, "Could not load the plugin library",
+                fostlib::string{::dlerror()});
+    }
+    entry = reinterpret_cast<decltype(&wright_job)>(
+            ::dlsym(library, "wright_job"));
+    if (not entry) {
+        ::dlclose(library);
+        throw fostlib::exceptions::not_implemented(
+                __func__, "The plugin library doesn't export wright_job",
+                fostlib::string{filename});
+    }
+    count = std::max<std::size_t>(count, 1u);
+    threads.reserve(count);
+    for (std::size_t thread{}; thread < count; ++thread) {
+        threads.emplace_back([this]() { work_loop(); });
+    }
+    fostlib::log::info(c_exec_helper)("", "Plugin loaded")(
+            "library", filename.c_str())("threads", threads.size());
+}
+
+
+wright::plugin_pool::~plugin_pool() {
+    close();
+    ::dlclose(library);
+}
+
+
+std::size_t wright::plugin_pool::capacity() const {
+    /// The queue is shared by all of the threads, so a deep queue can't
+    /// leave one thread busy while another is idle
+    return threads.size() * std::max(c_queue_depth_max.value(), buffer_size);
+}
+
+
+void wright::plugin_pool::execute(job work) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        queue.push_back(std::move(work));
+    }
+    signal.notify_one();
+}
+
+
+void wright::plugin_pool::close() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (closing) return;
+        closing = true;
+    }
+    signal.notify_all();
+    for (auto &thread : threads) thread.join();
+}
+
+
+void wright::plugin_pool::work_loop() {
+    const bool keep_result = c_results.value();
+    const std::size_t retries = c_plugin_retries.value();
+    while (true) {
+        job work;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            signal.wait(
+                    lock, [this]() { return closing || not queue.empty(); });
+            if (queue.empty()) return;
+            work = std::move(queue.front());
+            queue.pop_front();
+        }
+        work.time.reset();
+        std::string result;
+        bool succeeded = false;
+        for (std::size_t attempt{};; ++attempt) {
+            ++p_run;
+            if (not entry(work.command.data(), work.command.size(),
+                          append_result, &result)) {
+                if (keep_result) work.result = std::move(result);
+                succeeded = true;
+                break;
+            }
+            ++p_failed;
+            result.clear();
+            if (attempt >= retries) {
+                ++p_given_up;
+                fostlib::log::error(c_exec_helper)(
+                        "", "Plugin job failed too many times -- giving up")(
+                        "job", work.command.c_str())("attempts", attempt + 1u);
+                break;
+            }
+            fostlib::log::warning(c_exec_helper)(
+                    "", "Plugin job failed -- running it again")(
+                    "job", work.command.c_str())("attempt", attempt + 1u);
+        }
+        ios.post([this, succeeded, work = std::move(work)]() {
+            if (succeeded) {
+                done(work);
+            } else {
+                failed(work);
+            }
+        });
+    }
+}
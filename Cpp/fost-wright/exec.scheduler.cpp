@@ -0,0 +1,98 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/exec.childproc.hpp>
+#include <wright/exec.scheduler.hpp>
+
+#include <set>
+#include <tuple>
+
+
+namespace {
+
+
+    /// Hands jobs to each child in turn, skipping those with full queues
+    class round_robin final : public wright::scheduler {
+        wright::child_pool &pool;
+        std::size_t child_index = 0u;
+
+      public:
+        round_robin(wright::child_pool &p) : pool(p) {}
+
+        std::optional<std::size_t> select() override {
+            for (std::size_t tried{}; tried < pool.children.size(); ++tried) {
+                /** Do a rotate left first so we won't try the
+                    same child two times in a row without trying
+                    the others first. This should spread the jobs
+                    out across.
+                */
+                ++child_index;
+                child_index = child_index % pool.children.size();
+                if (not pool.children[child_index].full()) return child_index;
+            }
+            return {};
+        }
+    };
+
+
+    /// Gives the job to the child that we expect to finish it soonest,
+    /// based on how much work it already has queued and how long its jobs
+    /// have been taking. Children that have space are kept ordered by
+    /// their expected completion time so selection is O(log n).
+    class least_expected_completion final : public wright::scheduler {
+        wright::child_pool &pool;
+        /// The expected completion time, queue length and child index
+        using key = std::tuple<double, std::size_t, std::size_t>;
+        std::set<key> ready;
+        /// The key each child currently has in `ready`, if any
+        std::vector<std::optional<key>> keys;
+
+      public:
+        least_expected_completion(wright::child_pool &p)
+        : pool(p), keys(p.children.size()) {
+            for (std::size_t index{}; index < keys.size(); ++index) {
+                changed(index);
+            }
+        }
+
+        std::optional<std::size_t> select() override {
+            if (ready.empty()) return {};
+            return std::get<2>(*ready.begin());
+        }
+
+        void changed(std::size_t index) override {
+            if (keys.size() <= index) keys.resize(index + 1u);
+            auto &current = keys[index];
+            if (current) {
+                ready.erase(*current);
+                current.reset();
+            }
+            auto const &child = pool.children[index];
+            if (not child.full()) {
+                const auto queued = child.commands.size();
+                current = key{(queued + 1u) * child.mean_time, queued, index};
+                ready.insert(*current);
+            }
+        }
+    };
+
+
+}
+
+
+std::unique_ptr<wright::scheduler> wright::scheduler::make(
+        const fostlib::string &name, child_pool &pool) {
+    if (name == "round-robin") {
+        return std::make_unique<round_robin>(pool);
+    } else if (name == "least-expected-completion") {
+        return std::make_unique<least_expected_completion>(pool);
+    } else {
+        throw fostlib::exceptions::not_implemented(
+                __func__, "Unknown dispatch policy", name);
+    }
+}
@@ -8,10 +8,16 @@
 
 #include <wright/configuration.hpp>
 #include <wright/exception.hpp>
+#include <wright/exec.autoscale.hpp>
+#include <wright/exec.cache.hpp>
 #include <wright/exec.hpp>
 #include <wright/exec.capacity.hpp>
 #include <wright/exec.childproc.hpp>
+#include <wright/exec.input.hpp>
+#include <wright/exec.journal.hpp>
+#include <wright/exec.output.hpp>
 #include <wright/exec.watchdog.hpp>
+#include <wright/line_reader.hpp>
 #include <wright/net.server.hpp>
 
 #include <f5/threading/reactor.hpp>
@@ -24,6 +30,7 @@
 #include <algorithm>
 #include <future>
 
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 
@@ -34,36 +41,139 @@ using namespace std::literals::chrono_literals;
 namespace {
 
 
+    fostlib::performance p_cached(wright::c_exec_helper, "jobs", "cached");
+    fostlib::performance
+            p_output_stalled(wright::c_exec_helper, "output", "stalled");
+    fostlib::performance p_failed(wright::c_exec_helper, "jobs", "failed");
+
     boost::asio::posix::stream_descriptor
             connect_stdin(boost::asio::io_service &ctrlios) {
         boost::asio::posix::stream_descriptor as_stdin{ctrlios};
         boost::system::error_code error;
         as_stdin.assign(dup(STDIN_FILENO), error);
         if (error) {
-            std::cerr
-                    << "Cannot assign stdin to the reactor pool. This "
-                       "probably means you're trying to redirect a file rather "
-                       "than pipe the commands\n\nI.e. try this:\n"
-                       "   cat commands.txt | wright-exec-helper\n"
-                       "instead of\n"
-                       "   wright-exec-helper < commands.txt"
-                    << std::endl;
+            std::cerr << "Cannot assign stdin to the reactor pool. Either pipe "
+                         "the commands in or give a file of commands to the "
+                         "--input option\n\nI.e. try this:\n"
+                         "   wright-exec-helper --input commands.txt"
+                      << std::endl;
             std::exit(1);
         }
         return as_stdin;
     }
 
 
+    /// Open the job file given on the command line, or map stdin if a
+    /// regular file has been redirected to it
+    std::optional<wright::mapped_input> map_input() {
+        if (wright::c_input.value()) {
+            auto const filename = fostlib::coerce<fostlib::utf8_string>(
+                    wright::c_input.value().value());
+            int fd = ::open(filename.underlying().c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::system_error(errno, std::system_category());
+            }
+            auto input = wright::mapped_input::if_regular(fd);
+            ::close(fd);
+            if (not input) {
+                throw fostlib::exceptions::not_implemented(
+                        __func__, "The input file must be a regular file",
+                        wright::c_input.value().value());
+            }
+            return input;
+        } else {
+            return wright::mapped_input::if_regular(STDIN_FILENO);
+        }
+    }
+
+
+    /// Periodically log how far through the jobs we are
+    auto progress_reporter(
+            boost::asio::io_service &auxios,
+            std::size_t total,
+            const std::atomic<std::size_t> &finished,
+            const std::atomic<bool> &stop) {
+        return [&auxios, total, &finished, &stop](auto yield) {
+            boost::asio::steady_timer timer{auxios};
+            fostlib::timer elapsed;
+            while (not stop.load()) {
+                timer.expires_from_now(
+                        std::chrono::seconds{wright::c_progress_interval.value()});
+                timer.async_wait(yield);
+                const std::size_t done = finished.load();
+                auto logger = fostlib::log::warning(wright::c_exec_helper);
+                logger("", "Progress")("jobs", "done", done)(
+                        "jobs", "total", total)(
+                        "percent", total ? 100.0 * done / total : 100.0)(
+                        "elapsed", elapsed.seconds());
+                if (done && done < total) {
+                    logger("eta", elapsed.seconds() * (total - done) / done);
+                }
+            }
+        };
+    }
+
+
 }
 
 
 void wright::exec_helper(std::ostream &out, const char *command) {
     /// The parent sets up the communications redirects etc and spawns
-    /// child processes
-    child_pool pool(c_children.value(), command);
+    /// child processes. A plugin takes the place of the children
+    child_pool pool(c_plugin.value() ? 0 : c_children.value(), command);
 
     /// Set up a promise that we're going to wait to finish on
     std::promise<void> blocker;
+    /// Jobs completed on earlier runs can be skipped
+    std::optional<result_cache> cache;
+    if (c_cache.value() && c_results.value()) {
+        throw fostlib::exceptions::not_implemented(
+                __func__,
+                "The result cache only records that a job was done, so it "
+                "can't be used when worker results are captured");
+    } else if (c_cache.value()) {
+        cache.emplace(
+                static_cast<std::string>(
+                        fostlib::coerce<fostlib::utf8_string>(
+                                c_cache.value().value())
+                                .underlying()),
+                static_cast<std::string>(
+                        fostlib::coerce<fostlib::utf8_string>(
+                                c_cache_fingerprint.value())
+                                .underlying()));
+    }
+    /// Journal the work so a new manager can carry on if this one dies
+    std::optional<journal> history;
+    if (c_journal.value()) {
+        history.emplace(
+                static_cast<std::string>(
+                        fostlib::coerce<fostlib::utf8_string>(
+                                c_journal.value().value())
+                                .underlying()),
+                c_journal_resume.value());
+    }
+    /// Completed jobs are written to stdout from their own thread. This is
+    /// after the journal so that it stops first
+    result_writer results{STDOUT_FILENO};
+    /// Used for progress reporting
+    std::atomic<std::size_t> finished{};
+    std::atomic<bool> all_done{false};
+    auto completed = [&](const std::string &job, std::size_t times,
+                         std::optional<std::string_view> result) {
+        if (cache) cache->insert(job);
+        if (history) {
+            /// Only once the output has been written can a resumed run
+            /// skip the job
+            results.write(
+                    result ? *result : job, times,
+                    [&history, key = job_key::make(job), times]() {
+                        history->completed(key, times);
+                    });
+        } else {
+            results.write(result ? *result : job, times);
+        }
+        finished += times;
+    };
 
     /// Stop on exception, one thread. We want one thread here so
     /// we don't have to worry about thread synchronisation when
@@ -79,26 +189,58 @@ void wright::exec_helper(std::ostream &out, const char *command) {
     add_watchdog(ctrlios, auxios);
     add_watchdog(auxios, ctrlios);
 
-    /// Process the other end of the signal handler pipe
-    pool.sigchild_handling(auxios);
     /// Set up the child pool capacity
     capacity workers{ctrlios, pool};
+    /// Process the other end of the signal handler pipe
+    pool.sigchild_handling(ctrlios, workers);
+    workers.coalesce = capacity::duplicate_handling(c_duplicates.value());
+    workers.report = [&](const std::string &job, std::size_t times,
+                         std::optional<std::string_view> result,
+                         std::optional<uint64_t>) {
+        completed(job, times, result);
+    };
+    if (c_plugin.value()) {
+        workers.use_plugins(std::make_unique<plugin_pool>(
+                ctrlios,
+                static_cast<std::string>(
+                        fostlib::coerce<fostlib::utf8_string>(
+                                c_plugin.value().value())
+                                .underlying()),
+                c_plugin_threads.value(),
+                [&](const job &done) {
+                    completed(
+                            done.command, workers.job_done(done.command),
+                            done.result);
+                },
+                [&](const job &failed) {
+                    /// The job isn't written out, cached or journalled, so
+                    /// it is run again next time. Its limiter slot is
+                    /// given back when it goes out of scope
+                    ++p_failed;
+                    workers.job_done(failed.command);
+                }));
+    }
 
     /// All the children need a presence in the reactor pool for
     /// their process requirement
-    for (auto &child : pool.children) {
+    auto serve = [&](childproc &child) {
         auto *cp = &child;
+        /// Held by each of the child's coroutines so that the slot of a
+        /// retired child isn't re-used while any of them are still running
+        auto busy = cp->in_use();
         /// Each child will wait on the command, then write it
         /// the pipe for the process to execute and wait on the result
         boost::asio::spawn(
                 ctrlios,
                 exception_decorator(
-                        [&, cp](auto yield) {
+                        [&, cp, busy](auto yield) {
                             cp->handle_stdout(
                                     ctrlios, yield, workers.pool,
-                                    [&](const std::string &job) {
-                                        workers.job_done(job);
-                                        std::cout << job << std::endl;
+                                    [&](const job &done) {
+                                        completed(
+                                                done.command,
+                                                workers.job_done(*cp, done),
+                                                done.result);
                                     });
                         },
                         exit_on_error));
@@ -106,62 +248,145 @@ void wright::exec_helper(std::ostream &out, const char *command) {
         boost::asio::spawn(
                 ctrlios,
                 exception_decorator(
-                        [&, cp](auto yield) {
+                        [&, cp, busy](auto yield) {
                             cp->handle_child_requests(ctrlios, workers, yield);
                         },
                         exit_on_error));
         /// Finally, drain the child's stderr
-        boost::asio::spawn(auxios, exception_decorator([&, cp](auto yield) {
-                               cp->drain_stderr(auxios, yield);
-                           }));
+        boost::asio::spawn(
+                auxios, exception_decorator([&, cp, busy](auto yield) {
+                    cp->drain_stderr(auxios, yield);
+                }));
+    };
+    for (auto &child : pool.children) serve(child);
+    /// Grow and shrink the pool to suit the work
+    if (not c_plugin.value() && c_children_max.value() > c_children.value()) {
+        add_autoscaler(ctrlios, workers, serve);
+    }
+    /// With no local workers all of the work goes to networked clients.
+    /// Until one connects the input is read into the overspill
+    const bool dispatcher = not workers.children();
+    if (dispatcher && not c_port.value()) {
+        throw fostlib::exceptions::not_implemented(
+                __func__,
+                "A manager with no workers (-w 0) needs a port (-p) for "
+                "networked clients to connect to");
     }
+    auto holding = [&]() { return dispatcher && not workers.size(); };
     /// If the port setting is turned on then we will start the server
     if (c_port.value()) {
         start_server(auxios, ctrlios, c_port.value(), workers);
     }
 
-    /// This process now needs to read from stdin and queue the jobs
-    boost::asio::posix::stream_descriptor as_stdin{connect_stdin(ctrlios)};
+    /// This process now needs to read the jobs and queue them. A regular
+    /// file is mapped into memory, anything else must be a pipe
+    auto mapped = map_input();
+    std::optional<boost::asio::posix::stream_descriptor> as_stdin;
+    if (mapped) {
+        const auto total = mapped->count();
+        fostlib::log::warning(c_exec_helper)("", "Reading jobs from file")(
+                "jobs", total);
+        if (c_progress_interval.value()) {
+            boost::asio::spawn(
+                    auxios,
+                    exception_decorator(progress_reporter(
+                            auxios, total, finished, all_done)));
+        }
+    } else {
+        as_stdin.emplace(connect_stdin(ctrlios));
+    }
     boost::asio::spawn(
             ctrlios,
             exception_decorator(
                     [&](auto yield) {
-                        auto clear_overspill = [&]() {
-                            for (auto job{workers.overspill.consume()}; job;
-                                 job = workers.overspill.consume()) {
+                        /// Hold back more work while stdout can't keep
+                        /// up. This waits on the reactor, so everything
+                        /// else carries on as normal
+                        boost::asio::steady_timer output_wait{ctrlios};
+                        auto output_caught_up = [&]() {
+                            if (not results.backed_up()) return;
+                            ++p_output_stalled;
+                            do {
+                                output_wait.expires_from_now(
+                                        std::chrono::milliseconds{
+                                                c_output_flush_interval
+                                                        .value()});
+                                output_wait.async_wait(yield);
+                            } while (results.backed_up());
+                        };
+                        auto clear_overspill = [&](bool hold) {
+                            while (not(hold && holding())) {
+                                auto job = workers.overspill.consume();
+                                if (not job) break;
                                 fostlib::log::debug(c_exec_helper)(
                                         "", "Fetched overspill job")(
-                                        "job", (*job).c_str());
+                                        "job", job->command.c_str());
                                 workers.next_job(std::move(*job), yield);
                             }
                         };
-                        boost::asio::streambuf buffer;
-                        while (as_stdin.is_open()) {
-                            clear_overspill();
-                            /// Then consume stdin
-                            boost::system::error_code error;
-                            auto bytes = boost::asio::async_read_until(
-                                    as_stdin, buffer, '\n', yield[error]);
-                            if (error) {
-                                fostlib::log::info(c_exec_helper)(
-                                        "",
-                                        "Input error. Presumed end of work")(
-                                        "error", error)("bytes", bytes);
-                                break;
-                            } else if (bytes) {
-                                std::string line;
-                                for (; bytes; --bytes) {
-                                    char next = buffer.sbumpc();
-                                    if (next != 0 && next != '\n') {
-                                        line += next;
+                        auto dispatch = [&](std::string line) {
+                            if (history && history->completed_before(line)) {
+                                ++finished;
+                                return;
+                            } else if (cache && cache->contains(line)) {
+                                ++p_cached;
+                                results.write(line);
+                                ++finished;
+                                return;
+                            }
+                            if (history) history->accepted(line);
+                            if (workers.coalesced(line)) {
+                                return;
+                            } else if (holding()) {
+                                workers.overspill.produce({std::move(line)});
+                            } else {
+                                workers.next_job({std::move(line)}, yield);
+                            }
+                        };
+                        if (mapped) {
+                            while (auto line = mapped->next()) {
+                                output_caught_up();
+                                clear_overspill(true);
+                                dispatch(std::move(*line));
+                            }
+                        } else {
+                            line_reader lines;
+                            while (as_stdin->is_open()) {
+                                output_caught_up();
+                                clear_overspill(true);
+                                if (auto line = lines.next(); line) {
+                                    dispatch(std::string(*line));
+                                    continue;
+                                }
+                                /// Then consume stdin
+                                boost::system::error_code error;
+                                auto bytes =
+                                        lines.fill(*as_stdin, yield[error]);
+                                if (error) {
+                                    fostlib::log::info(c_exec_helper)(
+                                            "",
+                                            "Input error. Presumed end of "
+                                            "work")("error", error)(
+                                            "bytes", bytes);
+                                    if (auto last = lines.remainder();
+                                        not last.empty()) {
+                                        dispatch(std::string(last));
                                     }
+                                    break;
                                 }
-                                workers.next_job(std::move(line), yield);
                             }
                         }
-                        clear_overspill();
+                        /// Wait for capacity for anything still held
+                        clear_overspill(false);
                         workers.input_complete = true;
+                        /// Work from a lost client session can be put back
+                        /// into the overspill whilst we wait, so keep going
+                        /// until there is nothing left anywhere
                         workers.wait_until_all_done(yield);
+                        while (not workers.overspill.empty()) {
+                            clear_overspill(false);
+                            workers.wait_until_all_done(yield);
+                        }
                         blocker.set_value();
                     },
                     exit_on_error));
@@ -169,6 +394,10 @@ void wright::exec_helper(std::ostream &out, const char *command) {
     /// This needs to block here until all processing is done
     auto blocker_ready = blocker.get_future();
     blocker_ready.wait();
+    all_done = true;
+    results.close();
+    cache.reset();
+    history.reset();
 
     /// Terminating. Wait for children
     workers.close();
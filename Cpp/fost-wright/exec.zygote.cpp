@@ -0,0 +1,227 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/configuration.hpp>
+#include <wright/exec.childproc.hpp>
+#include <wright/exec.zygote.hpp>
+
+#include <fost/counter>
+#include <fost/log>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <system_error>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace {
+
+
+    fostlib::performance
+            p_forked(wright::c_exec_helper, "zygote", "forked");
+    fostlib::performance
+            p_restarted(wright::c_exec_helper, "zygote", "restarted");
+
+
+    void resend(const char *what) {
+        ::write(wright::c_resend_fd.value(), what, 1u);
+        /// A framed job only partly read by the dead worker would leave the
+        /// new one out of step with the records. The manager throws it away
+        /// and then tells us to carry on
+        if (wright::c_framed.value() && *what == 'r') {
+            wright::child_signals::await_resync();
+        }
+    }
+
+
+}
+
+
+/*
+ * wright::zygote_channel
+ */
+
+
+std::optional<std::string> wright::zygote_channel::read() {
+    while (true) {
+        if (auto pos = buffer.find('\n'); pos != std::string::npos) {
+            std::string line = buffer.substr(0, pos);
+            buffer.erase(0, pos + 1);
+            return line;
+        }
+        char block[256];
+        auto bytes = ::read(fd, block, sizeof(block));
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        } else if (bytes <= 0) {
+            return {};
+        }
+        buffer.append(block, bytes);
+    }
+}
+
+
+bool wright::zygote_channel::write(std::string_view line) {
+    std::string out{line};
+    out += '\n';
+    for (std::size_t written{}; written < out.size();) {
+        auto bytes = ::write(fd, out.data() + written, out.size() - written);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        } else if (bytes < 0) {
+            return false;
+        }
+        written += bytes;
+    }
+    return true;
+}
+
+
+void wright::zygote_channel::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+
+/*
+ * The zygote itself, running inside the worker process
+ */
+
+
+void wright::zygote() {
+    const char *variable = std::getenv(zygote_fd_variable);
+    if (not variable) return;
+    zygote_channel control{std::atoi(variable)};
+    ::unsetenv(zygote_fd_variable);
+    if (not control.write("ready")) std::exit(0);
+    while (auto request = control.read()) {
+        if (*request != "fork") {
+            std::cerr << "Unknown zygote request: " << *request << std::endl;
+            continue;
+        }
+        int pid = ::fork();
+        if (pid < 0) {
+            std::cerr << "Zygote fork failed: " << errno << std::endl;
+            std::exit(5);
+        } else if (pid == 0) {
+            /// This is the new worker. The channel is closed as it goes
+            /// out of scope
+            return;
+        }
+        control.write("pid " + std::to_string(pid));
+        int status{};
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+        control.write(
+                "exit " + std::to_string(pid) + " " + std::to_string(status));
+    }
+    /// The child process has gone, so all of the work is done
+    std::exit(0);
+}
+
+
+/*
+ * The child process side
+ */
+
+
+void wright::zygote_worker(const std::vector<char const *> &argv) {
+    while (true) {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+        int pid = ::fork();
+        if (pid < 0) {
+            fostlib::log::critical(c_exec_helper)("", "Fork failed")(
+                    "parent", ::getpid());
+            fostlib::log::flush();
+            std::exit(5);
+        } else if (pid == 0) {
+            ::close(fds[0]);
+            child_signals::reset();
+            ::setenv(zygote_fd_variable, std::to_string(fds[1]).c_str(), 1);
+            ::execvp(argv.front(), const_cast<char *const *>(argv.data()));
+            std::cerr << "Zygote process failed to start:";
+            for (auto part : argv)
+                if (part) std::cerr << " '" << part << '\'';
+            std::cerr << std::endl;
+            resend("x");
+            return;
+        }
+        ::close(fds[1]);
+        fostlib::log::info(c_exec_helper)("", "Started zygote process")(
+                "pid", pid)("resend-fd", wright::c_resend_fd.value());
+        /// The worker can be given work now. It reads it once it is ready
+        resend("s");
+
+        /// A worker that doesn't know about zygotes never says it is ready.
+        /// It just runs until it exits, and is then handled as if the
+        /// zygote itself had died
+        zygote_channel control{fds[0]};
+        if (control.read() == std::optional<std::string>{"ready"}) {
+            fostlib::log::info(c_exec_helper)("", "Zygote ready")("pid", pid);
+            while (control.write("fork")) {
+                auto started = control.read();
+                int worker{};
+                if (not started
+                    || std::sscanf(started->c_str(), "pid %d", &worker) != 1) {
+                    break;
+                }
+                ++p_forked;
+                fostlib::log::debug(c_exec_helper)(
+                        "", "Zygote forked worker")("pid", worker);
+                child_signals::worker(worker);
+                auto exited = control.read();
+                child_signals::worker(0);
+                int status{};
+                if (not exited
+                    || std::sscanf(exited->c_str(), "exit %*d %d", &status)
+                            != 1) {
+                    /// Don't leave the worker reading stdin alongside the
+                    /// replacement zygote's worker
+                    ::kill(worker, SIGKILL);
+                    break;
+                }
+                if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                    fostlib::log::info(c_exec_helper)(
+                            "", "Child completed")("pid", worker);
+                    control.close();
+                    ::waitpid(pid, &status, 0);
+                    return;
+                }
+                fostlib::log::warning(c_exec_helper)(
+                        "", "Zygote worker errored -- requesting resend")(
+                        "pid", worker)("status", status);
+                resend("r");
+            }
+        }
+
+        /// The zygote has gone away. Restart it
+        control.close();
+        int status;
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            fostlib::log::info(c_exec_helper)("", "Child completed")(
+                    "pid", pid);
+            return;
+        }
+        ++p_restarted;
+        fostlib::log::warning(c_exec_helper)(
+                "", "Zygote errored -- requesting resend")("pid", pid)(
+                "status", status);
+        resend("r");
+    }
+}
@@ -0,0 +1,60 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/frame.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+
+std::array<char, wright::frame_header_size>
+        wright::frame_header(uint64_t id, std::size_t length) {
+    if (length > frame_payload_max) {
+        throw std::length_error("Framed record payload is too long");
+    }
+    const uint32_t length32 = length;
+    std::array<char, frame_header_size> header;
+    std::memcpy(header.data(), &length32, sizeof(length32));
+    std::memcpy(header.data() + sizeof(length32), &id, sizeof(id));
+    return header;
+}
+
+
+std::pair<std::size_t, uint64_t> wright::frame_header(const char *header) {
+    uint32_t length;
+    uint64_t id;
+    std::memcpy(&length, header, sizeof(length));
+    std::memcpy(&id, header + sizeof(length), sizeof(id));
+    if (length > frame_payload_max) {
+        throw frame_error("Framed record header is out of step");
+    }
+    return {length, id};
+}
+
+
+bool wright::read_frame(std::istream &in, uint64_t &id, std::string &payload) {
+    std::array<char, frame_header_size> header;
+    if (not in.read(header.data(), header.size())) return false;
+    std::size_t length;
+    std::tie(length, id) = frame_header(header.data());
+    payload.resize(length);
+    return bool(in.read(payload.data(), length));
+}
+
+
+void wright::write_frame(
+        std::ostream &out, uint64_t id, std::string_view payload) {
+    std::string record(frame_header_size + payload.size(), '\0');
+    const auto header = frame_header(id, payload.size());
+    std::memcpy(record.data(), header.data(), header.size());
+    std::memcpy(
+            record.data() + header.size(), payload.data(), payload.size());
+    out.write(record.data(), record.size());
+    out.flush();
+}
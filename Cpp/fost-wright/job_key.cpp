@@ -0,0 +1,126 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/job_key.hpp>
+
+#include <cstring>
+
+
+namespace {
+
+
+    /// The 128 bit x64 variant of MurmurHash3
+    class murmur3 {
+        static constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+        static constexpr uint64_t c2 = 0x4cf5ad432745937full;
+        uint64_t h1, h2;
+        std::size_t length = 0u;
+        /// Bytes that haven't yet made up a full block
+        unsigned char tail[16];
+        std::size_t tail_size = 0u;
+
+        static uint64_t rotl(uint64_t x, int r) {
+            return (x << r) | (x >> (64 - r));
+        }
+        static uint64_t fmix(uint64_t k) {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdull;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ull;
+            k ^= k >> 33;
+            return k;
+        }
+        void block(const unsigned char *data) {
+            uint64_t k1, k2;
+            std::memcpy(&k1, data, 8);
+            std::memcpy(&k2, data + 8, 8);
+            k1 *= c1;
+            k1 = rotl(k1, 31);
+            k1 *= c2;
+            h1 ^= k1;
+            h1 = rotl(h1, 27);
+            h1 += h2;
+            h1 = h1 * 5 + 0x52dce729;
+            k2 *= c2;
+            k2 = rotl(k2, 33);
+            k2 *= c1;
+            h2 ^= k2;
+            h2 = rotl(h2, 31);
+            h2 += h1;
+            h2 = h2 * 5 + 0x38495ab5;
+        }
+
+      public:
+        murmur3(uint64_t seed = 0) : h1(seed), h2(seed) {}
+
+        void update(std::string_view data) {
+            auto bytes = reinterpret_cast<const unsigned char *>(data.data());
+            auto size = data.size();
+            length += size;
+            if (tail_size) {
+                const auto take = std::min(size, 16u - tail_size);
+                std::memcpy(tail + tail_size, bytes, take);
+                tail_size += take;
+                bytes += take;
+                size -= take;
+                if (tail_size < 16u) return;
+                block(tail);
+                tail_size = 0u;
+            }
+            for (; size >= 16u; bytes += 16, size -= 16) { block(bytes); }
+            std::memcpy(tail, bytes, size);
+            tail_size = size;
+        }
+
+        wright::job_key finish() {
+            uint64_t k1{}, k2{};
+            for (std::size_t i = tail_size; i > 8u; --i) {
+                k2 ^= uint64_t{tail[i - 1]} << ((i - 9) * 8);
+            }
+            for (std::size_t i = std::min<std::size_t>(tail_size, 8u); i;
+                 --i) {
+                k1 ^= uint64_t{tail[i - 1]} << ((i - 1) * 8);
+            }
+            if (tail_size > 8u) {
+                k2 *= c2;
+                k2 = rotl(k2, 33);
+                k2 *= c1;
+                h2 ^= k2;
+            }
+            if (tail_size) {
+                k1 *= c1;
+                k1 = rotl(k1, 31);
+                k1 *= c2;
+                h1 ^= k1;
+            }
+            h1 ^= length;
+            h2 ^= length;
+            h1 += h2;
+            h2 += h1;
+            h1 = fmix(h1);
+            h2 = fmix(h2);
+            h1 += h2;
+            h2 += h1;
+            return wright::job_key{h1, h2};
+        }
+    };
+
+
+}
+
+
+wright::job_key
+        wright::job_key::make(std::string_view job, std::string_view fingerprint) {
+    murmur3 hash;
+    if (not fingerprint.empty()) {
+        hash.update(fingerprint);
+        hash.update(std::string_view("\0", 1u));
+    }
+    hash.update(job);
+    return hash.finish();
+}
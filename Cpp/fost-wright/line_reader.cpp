@@ -0,0 +1,82 @@
+/**
+    Copyright 2016-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/line_reader.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+
+    /// Remove any NUL bytes from the range and return the new length
+    std::size_t strip_nuls(char *data, std::size_t length) {
+        if (std::memchr(data, 0, length) == nullptr) return length;
+        return std::remove(data, data + length, '\0') - data;
+    }
+
+
+}
+
+
+wright::line_reader::line_reader() : buffer(block_size) {}
+
+
+std::optional<std::string_view> wright::line_reader::next() {
+    auto const base = buffer.data() + start;
+    auto const nl = static_cast<char *>(std::memchr(base, '\n', end - start));
+    if (not nl) return {};
+    start = nl - buffer.data() + 1u;
+    /// For some reason I totally fail to understand we can actually end up
+    /// reading a sequence of zero byte values at the start of a child's
+    /// line. These are spurious and fail the comparison with the job we
+    /// sent, so they are dropped here.
+    return std::string_view(base, strip_nuls(base, nl - base));
+}
+
+
+std::optional<wright::frame> wright::line_reader::next_frame() {
+    if (end - start < frame_header_size) return {};
+    auto const base = buffer.data() + start;
+    auto const [length, id] = frame_header(base);
+    if (end - start < frame_header_size + length) return {};
+    start += frame_header_size + length;
+    return frame{id, std::string_view(base + frame_header_size, length)};
+}
+
+
+std::size_t wright::line_reader::fill(
+        boost::asio::posix::stream_descriptor &stream,
+        boost::asio::yield_context yield) {
+    if (start == end) {
+        start = end = 0u;
+    } else if (buffer.size() - end < block_size) {
+        /// Move the partial line (or record) to the front and make sure
+        /// there is room for a whole block after it
+        std::memmove(buffer.data(), buffer.data() + start, end - start);
+        end -= start;
+        start = 0u;
+        if (buffer.size() - end < block_size) {
+            buffer.resize(end + block_size);
+        }
+    }
+    auto const bytes = stream.async_read_some(
+            boost::asio::buffer(buffer.data() + end, buffer.size() - end),
+            yield);
+    end += bytes;
+    return bytes;
+}
+
+
+std::string_view wright::line_reader::remainder() {
+    auto const base = buffer.data() + start;
+    auto const length = strip_nuls(base, end - start);
+    start = end = 0u;
+    return std::string_view(base, length);
+}
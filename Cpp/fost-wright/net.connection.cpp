@@ -14,6 +14,7 @@
 #include <fost/log>
 
 #include <mutex>
+#include <random>
 
 
 namespace {
@@ -46,11 +47,84 @@ namespace {
 wright::connection::connection(
         boost::asio::io_service &ios, peering p, wright::capacity &cap)
 : tcp_connection(ios, p),
+  executes(ios),
+  completions(ios),
+  completed_ids(ios),
+  completed_results(ios),
   queue(ios),
   capacity(cap),
   reference(c_cnx, std::to_string(id)) {}
 
 
+void wright::connection::execute(task job) {
+    if (version() < 2u) {
+        queue.produce(out::execute(std::move(job.command)));
+    } else {
+        executes.add(
+                std::move(job), c_net_batch_size.value(),
+                std::chrono::milliseconds{c_net_batch_window.value()},
+                [self = shared_from_this()](std::vector<task> jobs) {
+                    if (self->version() < 4u) {
+                        std::vector<std::string> commands;
+                        commands.reserve(jobs.size());
+                        for (auto &job : jobs) {
+                            commands.push_back(std::move(job.command));
+                        }
+                        self->queue.produce(out::execute(std::move(commands)));
+                    } else {
+                        self->queue.produce(out::execute(std::move(jobs)));
+                    }
+                });
+    }
+}
+
+
+void wright::connection::completed(
+        std::string job,
+        std::optional<uint64_t> id,
+        std::optional<std::string> result) {
+    if (result && version() < 5u && not warned_results.exchange(true)) {
+        fostlib::log::warning(reference)(
+                "", "Remote end is too old to be sent job results")(
+                "version", int64_t(version()));
+    }
+    if (result && id && version() >= 5u) {
+        completed_results.add(
+                {*id, std::move(*result)}, c_net_batch_size.value(),
+                std::chrono::milliseconds{c_net_batch_window.value()},
+                [self = shared_from_this()](
+                        std::vector<std::pair<uint64_t, std::string>> done) {
+                    self->queue.produce(out::completed(std::move(done)));
+                });
+    } else if (version() < 3u) {
+        queue.produce(out::completed(job));
+    } else if (version() < 4u || not id) {
+        completions.add(
+                std::move(job), c_net_batch_size.value(),
+                std::chrono::milliseconds{c_net_batch_window.value()},
+                [self = shared_from_this()](std::vector<std::string> jobs) {
+                    self->queue.produce(out::completed(std::move(jobs)));
+                });
+    } else {
+        completed_ids.add(
+                *id, c_net_batch_size.value(),
+                std::chrono::milliseconds{c_net_batch_window.value()},
+                [self = shared_from_this()](std::vector<uint64_t> ids) {
+                    self->queue.produce(out::completed_ids(std::move(ids)));
+                });
+    }
+}
+
+
+uint64_t wright::connection::session_id() {
+    static const uint64_t session = []() {
+        std::random_device rd;
+        return (uint64_t{rd()} << 32) | rd();
+    }();
+    return session;
+}
+
+
 void wright::connection::wait_for_close() {
     auto blocker_ready = blocker.get_future();
     blocker_ready.wait();
@@ -88,6 +162,7 @@ std::size_t wright::connection::close_all() {
 
 void wright::connection::process_inbound(boost::asio::yield_context yield) {
     auto redistribute = [&](bool from_catch) {
+        lost = true;
         if (peer == client_side) {
             /// Network connection has closed...
             fostlib::log::info(c_exec_helper)(
@@ -99,8 +174,9 @@ void wright::connection::process_inbound(boost::asio::yield_context yield) {
             fostlib::log::warning(c_exec_helper)(
                     "",
                     "Network connection closed -- re-distributing outstanding "
-                    "work")("from-catch", from_catch);
-            capacity.overspill_work(shared_from_this());
+                    "work unless the client comes back")(
+                    "from-catch", from_catch);
+            capacity.disconnected(shared_from_this());
         }
     };
     try {
@@ -128,5 +204,9 @@ void wright::connection::process_outbound(boost::asio::yield_context yield) {
 
 void wright::connection::established() {
     live(shared_from_this());
-    queue.produce(out::version(capacity));
+    if (peer == client_side) {
+        queue.produce(out::version(capacity, session_id()));
+    } else {
+        queue.produce(out::version(capacity));
+    }
 }
@@ -14,6 +14,8 @@
 #include <fost/hod/decoder-io.hpp>
 #include <fost/unicode>
 
+#include <cstring>
+
 
 namespace {
     fostlib::performance
@@ -21,13 +23,14 @@ namespace {
     fostlib::performance
             p_in_version(wright::c_exec_helper, "network", "in", "version");
 }
-fostlib::hod::out_packet wright::out::version(capacity &cap) {
-    const std::size_t total_capacity =
-            cap.size() + c_overspill_cap_per_worker.value() * cap.children();
+fostlib::hod::out_packet wright::out::version(
+        capacity &cap, std::optional<uint64_t> session) {
+    const std::size_t total_capacity = cap.advertised();
     ++p_out_version;
     fostlib::hod::out_packet packet{packet::version};
     packet << g_proto.max_version();
     packet << uint64_t{total_capacity};
+    if (session) packet << *session;
     return packet;
 }
 void wright::in::version(
@@ -44,14 +47,20 @@ void wright::in::version(
     if (packet.size()) {
         const auto capacity = fostlib::hod::read<uint64_t>(packet);
         if (cnx->peer == connection::server_side) {
+            /// Clients that can resume their session send its ID
+            std::optional<uint64_t> session;
+            if (packet.size()) session = fostlib::hod::read<uint64_t>(packet);
             logger("", "Version packet processed -- adding capacity")(
                     "capacity", "remote",
-                    capacity)("capacity", "local", "old", cnx->capacity.size());
-            cnx->capacity.additional(cnx, capacity);
+                    capacity)("capacity", "local", "old", cnx->capacity.size())(
+                    "session", session ? fostlib::json(int64_t(*session))
+                                       : fostlib::json());
+            cnx->capacity.additional(cnx, capacity, session);
             logger("capacity", "local", "new", cnx->capacity.size());
         } else {
             logger("",
                    "Version packet processed")("capacity", "remote", capacity);
+            cnx->capacity.upstream_connected(cnx);
         }
     } else {
         logger("", "Version packet processed (without capacity)");
@@ -59,6 +68,55 @@ void wright::in::version(
 }
 
 
+namespace {
+    fostlib::performance p_out_capacity_update(
+            wright::c_exec_helper, "network", "out", "capacity_update");
+    fostlib::performance p_in_capacity_update(
+            wright::c_exec_helper, "network", "in", "capacity_update");
+}
+fostlib::hod::out_packet wright::out::capacity_update(uint64_t cap) {
+    ++p_out_capacity_update;
+    fostlib::hod::out_packet packet{packet::capacity_update};
+    packet << cap;
+    return packet;
+}
+void wright::in::capacity_update(
+        std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
+    ++p_in_capacity_update;
+    const auto capacity = fostlib::hod::read<uint64_t>(packet);
+    fostlib::log::info(c_exec_helper)("", "Capacity packet processed")(
+            "connection", "id", cnx->id)("capacity", "remote", capacity);
+    if (cnx->peer == connection::server_side) {
+        cnx->capacity.update(cnx, capacity);
+    }
+}
+
+
+namespace {
+    fostlib::performance p_out_session_resume(
+            wright::c_exec_helper, "network", "out", "session_resume");
+    fostlib::performance p_in_session_resume(
+            wright::c_exec_helper, "network", "in", "session_resume");
+}
+fostlib::hod::out_packet
+        wright::out::session_resume(std::vector<uint64_t> ids) {
+    ++p_out_session_resume;
+    fostlib::hod::out_packet packet{packet::session_resume};
+    packet << uint64_t{ids.size()};
+    for (auto const id : ids) { packet << id; }
+    return packet;
+}
+void wright::in::session_resume(
+        std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
+    ++p_in_session_resume;
+    std::vector<uint64_t> ids;
+    for (auto count = fostlib::hod::read<uint64_t>(packet); count; --count) {
+        ids.push_back(fostlib::hod::read<uint64_t>(packet));
+    }
+    cnx->capacity.resumed(cnx, ids);
+}
+
+
 namespace {
     fostlib::performance
             p_out_execute(wright::c_exec_helper, "network", "out", "execute");
@@ -74,8 +132,59 @@ fostlib::hod::out_packet wright::out::execute(std::string job) {
 void wright::in::execute(
         std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
     ++p_in_execute;
-    cnx->capacity.overspill.produce(static_cast<std::string>(
-            fostlib::hod::read<fostlib::utf8_string>(packet).underlying()));
+    cnx->capacity.overspill.produce(wright::task{static_cast<std::string>(
+            fostlib::hod::read<fostlib::utf8_string>(packet).underlying())});
+}
+namespace {
+    fostlib::performance p_out_execute_batch(
+            wright::c_exec_helper, "network", "out", "execute_batch");
+    fostlib::performance p_in_execute_batch(
+            wright::c_exec_helper, "network", "in", "execute_batch");
+}
+fostlib::hod::out_packet wright::out::execute(std::vector<std::string> jobs) {
+    ++p_out_execute_batch;
+    fostlib::hod::out_packet packet(packet::execute_batch);
+    packet << uint64_t{jobs.size()};
+    for (auto &job : jobs) { packet << fostlib::string{std::move(job)}; }
+    return packet;
+}
+void wright::in::execute_batch(
+        std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
+    ++p_in_execute_batch;
+    for (auto jobs = fostlib::hod::read<uint64_t>(packet); jobs; --jobs) {
+        cnx->capacity.overspill.produce(wright::task{static_cast<std::string>(
+                fostlib::hod::read<fostlib::utf8_string>(packet)
+                        .underlying())});
+    }
+}
+namespace {
+    fostlib::performance p_out_execute_ids(
+            wright::c_exec_helper, "network", "out", "execute_ids");
+    fostlib::performance p_in_execute_ids(
+            wright::c_exec_helper, "network", "in", "execute_ids");
+}
+fostlib::hod::out_packet wright::out::execute(std::vector<task> jobs) {
+    ++p_out_execute_ids;
+    fostlib::hod::out_packet packet(packet::execute_ids);
+    packet << uint64_t{jobs.size()};
+    for (auto &job : jobs) {
+        packet << job.id.value();
+        packet << fostlib::string{std::move(job.command)};
+    }
+    return packet;
+}
+void wright::in::execute_ids(
+        std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
+    ++p_in_execute_ids;
+    for (auto jobs = fostlib::hod::read<uint64_t>(packet); jobs; --jobs) {
+        const auto id = fostlib::hod::read<uint64_t>(packet);
+        cnx->capacity.received(id);
+        cnx->capacity.overspill.produce(wright::task{
+                static_cast<std::string>(
+                        fostlib::hod::read<fostlib::utf8_string>(packet)
+                                .underlying()),
+                id});
+    }
 }
 namespace {
     fostlib::performance p_out_completed(
@@ -99,6 +208,112 @@ void wright::in::completed(
                             .underlying()));
 }
 
+namespace {
+    fostlib::performance p_out_completed_batch(
+            wright::c_exec_helper, "network", "out", "completed_batch");
+    fostlib::performance p_in_completed_batch(
+            wright::c_exec_helper, "network", "in", "completed_batch");
+}
+fostlib::hod::out_packet wright::out::completed(std::vector<std::string> jobs) {
+    ++p_out_completed_batch;
+    fostlib::hod::out_packet packet(packet::completed_batch);
+    packet << uint64_t{jobs.size()};
+    for (auto &job : jobs) { packet << fostlib::string{std::move(job)}; }
+    return packet;
+}
+void wright::in::completed_batch(
+        std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
+    ++p_in_completed_batch;
+    std::vector<std::string> jobs;
+    for (auto count = fostlib::hod::read<uint64_t>(packet); count; --count) {
+        jobs.push_back(static_cast<std::string>(
+                fostlib::hod::read<fostlib::utf8_string>(packet)
+                        .underlying()));
+    }
+    cnx->capacity.job_done(cnx, jobs);
+}
+namespace {
+    fostlib::performance p_out_completed_ids(
+            wright::c_exec_helper, "network", "out", "completed_ids");
+    fostlib::performance p_in_completed_ids(
+            wright::c_exec_helper, "network", "in", "completed_ids");
+}
+fostlib::hod::out_packet wright::out::completed_ids(std::vector<uint64_t> ids) {
+    ++p_out_completed_ids;
+    fostlib::hod::out_packet packet(packet::completed_ids);
+    packet << uint64_t{ids.size()};
+    for (auto const id : ids) { packet << id; }
+    return packet;
+}
+void wright::in::completed_ids(
+        std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
+    ++p_in_completed_ids;
+    std::vector<uint64_t> ids;
+    for (auto count = fostlib::hod::read<uint64_t>(packet); count; --count) {
+        ids.push_back(fostlib::hod::read<uint64_t>(packet));
+    }
+    cnx->capacity.job_done(cnx, ids);
+}
+namespace {
+    fostlib::performance p_out_completed_results(
+            wright::c_exec_helper, "network", "out", "completed_results");
+    fostlib::performance p_in_completed_results(
+            wright::c_exec_helper, "network", "in", "completed_results");
+
+    /// Results can hold any bytes, but packets only carry integers and
+    /// UTF-8 strings. The bytes are sent as 64 bit words, preceded by the
+    /// length.
+    void write_bytes(fostlib::hod::out_packet &packet, std::string_view bytes) {
+        packet << uint64_t{bytes.size()};
+        for (std::size_t pos{}; pos < bytes.size(); pos += sizeof(uint64_t)) {
+            uint64_t word{};
+            std::memcpy(
+                    &word, bytes.data() + pos,
+                    std::min(sizeof(word), bytes.size() - pos));
+            packet << word;
+        }
+    }
+    std::string read_bytes(fostlib::hod::tcp_decoder &packet) {
+        const auto length = fostlib::hod::read<uint64_t>(packet);
+        /// Every word takes at least a byte, so a length needing more
+        /// words than there are bytes left can't be genuine
+        if (length / sizeof(uint64_t) > packet.size()) {
+            throw fostlib::exceptions::not_implemented(
+                    __func__, "Result is longer than the packet",
+                    fostlib::json(int64_t(length)));
+        }
+        std::string bytes(length, '\0');
+        for (std::size_t pos{}; pos < bytes.size(); pos += sizeof(uint64_t)) {
+            const auto word = fostlib::hod::read<uint64_t>(packet);
+            std::memcpy(
+                    bytes.data() + pos, &word,
+                    std::min(sizeof(word), bytes.size() - pos));
+        }
+        return bytes;
+    }
+}
+fostlib::hod::out_packet wright::out::completed(
+        std::vector<std::pair<uint64_t, std::string>> results) {
+    ++p_out_completed_results;
+    fostlib::hod::out_packet packet(packet::completed_results);
+    packet << uint64_t{results.size()};
+    for (auto const &[id, result] : results) {
+        packet << id;
+        write_bytes(packet, result);
+    }
+    return packet;
+}
+void wright::in::completed_results(
+        std::shared_ptr<connection> cnx, fostlib::hod::tcp_decoder &packet) {
+    ++p_in_completed_results;
+    std::vector<std::pair<uint64_t, std::string>> results;
+    for (auto count = fostlib::hod::read<uint64_t>(packet); count; --count) {
+        const auto id = fostlib::hod::read<uint64_t>(packet);
+        results.emplace_back(id, read_bytes(packet));
+    }
+    cnx->capacity.job_done(cnx, results);
+}
+
 
 namespace {
     fostlib::performance p_out_log_message(
@@ -22,7 +22,20 @@ const wright::protocol_definition wright::g_proto(
          {// Version 1
           {packet::execute, in::execute},
           {packet::completed, in::completed},
-          {packet::log_message, in::log_message}}});
+          {packet::log_message, in::log_message}},
+         {// Version 2
+          {packet::execute_batch, in::execute_batch}},
+         {// Version 3
+          {packet::completed_batch, in::completed_batch}},
+         {// Version 4
+          {packet::execute_ids, in::execute_ids},
+          {packet::completed_ids, in::completed_ids}},
+         {// Version 5
+          {packet::completed_results, in::completed_results}},
+         {// Version 6
+          {packet::capacity_update, in::capacity_update}},
+         {// Version 7
+          {packet::session_resume, in::session_resume}}});
 
 
 namespace {
@@ -10,13 +10,14 @@
 
 #include <system_error>
 
+#include <fcntl.h>
 #include <unistd.h>
 
 
 std::pair<int, int>
         wright::detail::pipe_fds(std::size_t parent, std::size_t child) {
     std::array<int, 2> p{{0, 0}};
-    if (::pipe(p.data()) < 0)
+    if (::pipe2(p.data(), O_CLOEXEC) < 0)
         throw std::system_error(errno, std::system_category());
     return std::make_pair(p[parent], p[child]);
 }
@@ -29,7 +30,28 @@ int wright::detail::close(int &fd) {
 
 
 int wright::detail::dup(int fd) {
-    auto nfd = ::dup(fd);
+    auto nfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
     if (nfd < 0) throw std::system_error(errno, std::system_category());
     return nfd;
 }
+
+
+std::size_t wright::detail::discard(int fd) {
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0) throw std::system_error(errno, std::system_category());
+    ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    std::size_t discarded{};
+    std::array<char, 4096> buffer;
+    while (true) {
+        auto const bytes = ::read(fd, buffer.data(), buffer.size());
+        if (bytes > 0) {
+            discarded += bytes;
+        } else if (bytes < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+    ::fcntl(fd, F_SETFL, flags);
+    return discarded;
+}
@@ -0,0 +1,161 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#include <wright/configuration.hpp>
+#include <wright/spill_queue.hpp>
+
+#include <fost/log>
+
+#include <system_error>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+
+namespace {
+
+
+    fostlib::performance
+            p_spooled(wright::c_exec_helper, "overspill", "spooled");
+    fostlib::performance
+            p_unspooled(wright::c_exec_helper, "overspill", "unspooled");
+
+
+    /// The header written before each task in the spool file
+    struct record {
+        uint64_t has_id, id, length;
+    };
+
+
+    void write_all(int fd, const void *data, std::size_t length, off_t offset) {
+        auto p = static_cast<const char *>(data);
+        while (length) {
+            auto const written = ::pwrite(fd, p, length, offset);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::system_category());
+            }
+            p += written;
+            length -= written;
+            offset += written;
+        }
+    }
+    void read_all(int fd, void *data, std::size_t length, off_t offset) {
+        auto p = static_cast<char *>(data);
+        while (length) {
+            auto const got = ::pread(fd, p, length, offset);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::system_category());
+            } else if (got == 0) {
+                throw fostlib::exceptions::unexpected_eof(
+                        "Overspill spool file is shorter than expected");
+            }
+            p += got;
+            length -= got;
+            offset += got;
+        }
+    }
+
+
+}
+
+
+wright::spill_queue::spill_queue(boost::asio::io_service &ios)
+: memory(ios) {}
+
+
+wright::spill_queue::~spill_queue() {
+    if (fd >= 0) ::close(fd);
+}
+
+
+void wright::spill_queue::produce(task t) {
+    const auto size = cost(t);
+    if (spooled == 0u
+        && (in_memory == 0u
+            || bytes + size <= c_overspill_memory.value())) {
+        ++in_memory;
+        bytes += size;
+        memory.produce(std::move(t));
+    } else {
+        spool(t);
+    }
+}
+
+
+wright::task wright::spill_queue::consume(boost::asio::yield_context yield) {
+    return taken(memory.consume(yield));
+}
+
+
+std::optional<wright::task> wright::spill_queue::consume() {
+    auto t = memory.consume();
+    if (t) return taken(std::move(*t));
+    return t;
+}
+
+
+wright::task wright::spill_queue::taken(task t) {
+    --in_memory;
+    bytes -= cost(t);
+    if (spooled) refill();
+    return t;
+}
+
+
+void wright::spill_queue::spool(const task &t) {
+    if (fd < 0) {
+        auto const directory = fostlib::coerce<fostlib::utf8_string>(
+                c_overspill_directory.value());
+        std::string name =
+                directory.underlying() + "/wright-overspill-XXXXXX";
+        fd = ::mkstemp(name.data());
+        if (fd < 0) throw std::system_error(errno, std::system_category());
+        /// Nobody else needs to see the file, and this way it goes away
+        /// when we do
+        ::unlink(name.c_str());
+        fostlib::log::warning(c_exec_helper)(
+                "", "Overspill memory budget reached -- spooling to disk")(
+                "budget", c_overspill_memory.value())("directory",
+                                                      c_overspill_directory.value());
+    }
+    const record r{t.id.has_value(), t.id.value_or(0u), t.command.size()};
+    write_all(fd, &r, sizeof(r), write_offset);
+    write_all(fd, t.command.data(), t.command.size(), write_offset + sizeof(r));
+    write_offset += sizeof(r) + t.command.size();
+    ++spooled;
+    ++p_spooled;
+}
+
+
+void wright::spill_queue::refill() {
+    while (spooled) {
+        record r;
+        read_all(fd, &r, sizeof(r), read_offset);
+        if (in_memory
+            && bytes + sizeof(task) + r.length > c_overspill_memory.value()) {
+            return;
+        }
+        task t;
+        t.command.resize(r.length);
+        read_all(fd, t.command.data(), r.length, read_offset + sizeof(r));
+        if (r.has_id) t.id = r.id;
+        read_offset += sizeof(r) + r.length;
+        --spooled;
+        ++p_unspooled;
+        ++in_memory;
+        bytes += cost(t);
+        memory.produce(std::move(t));
+    }
+    /// The spool is empty so the file can be re-used from the start
+    read_offset = write_offset = 0u;
+    if (::ftruncate(fd, 0) < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+}
@@ -24,19 +24,108 @@ namespace wright {
     extern const fostlib::setting<int64_t> c_child;
     /// The number of children to spawn
     extern const fostlib::setting<int64_t> c_children;
+    /// The largest number of children the pool may grow to. When this is
+    /// more than `c_children` the pool grows while the input is backed up
+    /// and shrinks back towards `c_children` when workers are idle
+    extern const fostlib::setting<int64_t> c_children_max;
+    /// How often (in milliseconds) to decide whether to grow or shrink
+    /// the pool
+    extern const fostlib::setting<unsigned> c_scale_interval;
     /// The file descriptor to use for resend notificaitons
     extern const fostlib::setting<int> c_resend_fd;
     /// The child program to execute
     extern const fostlib::setting<fostlib::json> c_exec;
+    /// Start the worker once as a zygote and fork fresh workers from it
+    /// when one dies, instead of running the full command line again
+    extern const fostlib::setting<bool> c_zygote;
+    /// Have the manager fork and restart the workers itself instead of
+    /// running a process supervisor (`--child`) for each of them
+    extern const fostlib::setting<bool> c_direct_supervision;
+    /// Use the length prefixed (framed) protocol to talk to the workers.
+    /// The workers are told by adding `--framed true` to their command line
+    extern const fostlib::setting<bool> c_framed;
+    /// Write the result payload each worker returns instead of the job.
+    /// Needs the framed protocol
+    extern const fostlib::setting<bool> c_results;
+    /// A shared library exporting `wright_job`. When given, jobs are run
+    /// on a pool of threads inside this process instead of by worker
+    /// processes
+    extern const fostlib::setting<fostlib::nullable<fostlib::string>> c_plugin;
+    /// The number of threads used to run plugin jobs
+    extern const fostlib::setting<std::size_t> c_plugin_threads;
+    /// The number of times a failed plugin job is run again before it is
+    /// reported as failed
+    extern const fostlib::setting<std::size_t> c_plugin_retries;
+    /// The smallest and largest number of jobs queued for each worker
+    extern const fostlib::setting<std::size_t> c_queue_depth_min;
+    extern const fostlib::setting<std::size_t> c_queue_depth_max;
+    /// The amount of work (in milliseconds) that we want queued for each
+    /// worker. Each worker's queue depth is adjusted so that it holds about
+    /// this much work based on its measured job times.
+    extern const fostlib::setting<unsigned> c_queue_target;
+    /// The number of jobs each worker runs at the same time. Workers with
+    /// a concurrency above one may complete their jobs in any order.
+    extern const fostlib::setting<std::size_t> c_worker_concurrency;
+    /// The policy used to pick which local child gets the next job. Either
+    /// `round-robin` or `least-expected-completion`
+    extern const fostlib::setting<fostlib::string> c_dispatch_policy;
+    /// The file used to record jobs that have completed. Jobs found in it
+    /// are reported as done without being run again.
+    extern const fostlib::setting<fostlib::nullable<fostlib::string>> c_cache;
+    /// Extra data mixed into the key for each job in the result cache.
+    /// Change it to invalidate all earlier results.
+    extern const fostlib::setting<fostlib::string> c_cache_fingerprint;
+    /// The file used to journal accepted and completed jobs
+    extern const fostlib::setting<fostlib::nullable<fostlib::string>>
+            c_journal;
+    /// Set to true to replay an existing journal and skip the jobs that
+    /// it shows as completed
+    extern const fostlib::setting<bool> c_journal_resume;
+    /// The shortest time (in milliseconds) between journal commits
+    extern const fostlib::setting<unsigned> c_journal_commit_interval;
+    /// A file to read jobs from instead of stdin
+    extern const fostlib::setting<fostlib::nullable<fostlib::string>> c_input;
+    /// How often (in seconds) to report progress when the total number of
+    /// jobs is known. Zero turns the reports off.
+    extern const fostlib::setting<unsigned> c_progress_interval;
 
     /// The port for the server
     extern const fostlib::setting<uint16_t> c_port;
     /// The netloc to connect to (instead of reading from stdin)
     extern const fostlib::setting<fostlib::nullable<fostlib::string>> c_connect;
+    /// How long (in seconds) a server keeps a lost client's jobs waiting
+    /// for it to reconnect, and how long a client tries to reconnect for.
+    /// Zero turns session resumption off
+    extern const fostlib::setting<unsigned> c_session_grace;
+    /// The port a networked client listens on for its own clients. When
+    /// set the client relays work between its server and them
+    extern const fostlib::setting<uint16_t> c_relay_port;
     /// Target overspill capacity per worker. This should be used to account
     /// for extra network latency. Increase as appropriate to prevent work
     /// stalls.
     extern const fostlib::setting<std::size_t> c_overspill_cap_per_worker;
+    /// The number of bytes of jobs that the overspill may hold in memory
+    /// before it spools further jobs to disk
+    extern const fostlib::setting<std::size_t> c_overspill_memory;
+    /// The directory that the overspill spool file is created in
+    extern const fostlib::setting<fostlib::string> c_overspill_directory;
+    /// The maximum number of jobs sent to a connection in a single packet
+    extern const fostlib::setting<std::size_t> c_net_batch_size;
+    /// How long (in milliseconds) to wait for more jobs before sending a
+    /// partially filled batch
+    extern const fostlib::setting<unsigned> c_net_batch_window;
+    /// How to handle a job that is identical to one still in flight. One of
+    /// `run` (run it again), `each` (run once, but print once per
+    /// submission) or `once` (run and print only once)
+    extern const fostlib::setting<fostlib::string> c_duplicates;
+    /// The longest time (in milliseconds) that a completed job waits
+    /// before being written to stdout
+    extern const fostlib::setting<unsigned> c_output_flush_interval;
+    /// Completed jobs are written as soon as this many bytes are waiting
+    extern const fostlib::setting<std::size_t> c_output_flush_size;
+    /// Once this many bytes of completed jobs are waiting to be written
+    /// no more work is handed out until they have been
+    extern const fostlib::setting<std::size_t> c_output_high_water;
 
     /// Whether to simulate
     extern const fostlib::setting<bool> c_simulate;
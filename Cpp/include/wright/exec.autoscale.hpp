@@ -0,0 +1,30 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <wright/exec.capacity.hpp>
+
+#include <functional>
+
+
+namespace wright {
+
+
+    /// Grow the child pool (up to `c_children_max`) while the dispatcher
+    /// is waiting for queue space, and shrink it (down to `c_children`)
+    /// when children have nothing to do. `serve` is called with each new
+    /// child so that its pipes can be serviced.
+    void add_autoscaler(
+            boost::asio::io_service &ctrlios,
+            capacity &,
+            std::function<void(childproc &)> serve);
+
+
+}
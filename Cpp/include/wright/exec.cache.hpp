@@ -0,0 +1,62 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <wright/job_key.hpp>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+
+namespace wright {
+
+
+    /// An on-disk record of the jobs that have completed successfully.
+    ///
+    /// The file is a short header followed by 16 byte job keys. The first
+    /// part of the file is sorted and is searched directly through a
+    /// memory mapping. Keys added later are appended to the end and held
+    /// in memory. When the unsorted tail gets too long the file is
+    /// re-written with all of the keys sorted.
+    class result_cache final {
+        const std::string filename, fingerprint;
+        int fd = -1;
+        /// The memory mapping of the sorted part of the file
+        void *mapping = nullptr;
+        std::size_t mapping_size = 0u;
+        const job_key *sorted = nullptr;
+        std::size_t sorted_count = 0u;
+        /// Keys that are not in the sorted part of the file
+        std::unordered_set<job_key> tail;
+        /// Keys waiting to be appended to the file
+        std::vector<job_key> pending;
+
+        void compact(std::size_t records);
+
+      public:
+        /// Open (or create) the cache file
+        result_cache(std::string filename, std::string fingerprint);
+        ~result_cache();
+
+        result_cache(const result_cache &) = delete;
+        result_cache &operator=(const result_cache &) = delete;
+
+        /// Returns true if the job is known to have completed
+        bool contains(std::string_view job) const;
+        /// Record that the job has completed
+        void insert(std::string_view job);
+
+        /// Write any pending keys to the file
+        void flush();
+    };
+
+
+}
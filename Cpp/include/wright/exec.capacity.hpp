@@ -10,9 +10,20 @@
 
 
 #include <wright/exec.childproc.hpp>
+#include <wright/exec.plugin.hpp>
+#include <wright/exec.scheduler.hpp>
+#include <wright/job_table.hpp>
+#include <wright/spill_queue.hpp>
 
 #include <f5/threading/queue.hpp>
 
+#include <boost/asio/steady_timer.hpp>
+
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
 
 namespace wright {
 
@@ -24,44 +35,221 @@ namespace wright {
     class capacity {
         /// The total capacity of all work queues. So long as this limit
         f5::fd::limiter limit;
-        /// This is used
-        std::size_t child_index = 0u;
+        /// Decides which local child gets the next job
+        std::unique_ptr<scheduler> policy;
+        /// In-process workers. When there are some all local jobs are
+        /// given to them instead of to the children
+        std::unique_ptr<plugin_pool> plugins;
         using weak_connection = std::weak_ptr<connection>;
+        struct outstanding {
+            std::string command;
+            std::unique_ptr<f5::fd::limiter::job> limiter;
+            /// The ID the job had when it was given to us, if any
+            std::optional<uint64_t> id;
+            fostlib::timer time;
+        };
         struct remote {
             uint64_t cap;
-            std::map<std::string, std::unique_ptr<f5::fd::limiter::job>> work;
+            weak_connection cnx;
+            job_table<outstanding> work;
+            /// Moving average of the time (in seconds) from sending a job
+            /// to hearing it is done
+            double mean_time = 0;
+            /// The virtual time for weighted fair dispatch. Each job sent
+            /// advances it by the reciprocal of the connection's weight.
+            double pass = 0;
+            /// The connection's key in `ready` if it has spare capacity
+            std::optional<std::tuple<double, int64_t, remote *>> key;
+            /// The client's session ID, if it can resume its session
+            std::optional<uint64_t> session;
+            /// Jobs taken over from the client's last connection that it
+            /// hasn't yet told us it still has
+            std::vector<uint64_t> unconfirmed;
         };
         std::map<weak_connection, remote, std::owner_less<weak_connection>>
                 connections;
+        /// The work for clients that have gone, waiting for them to
+        /// reconnect. Once the grace period runs out the work is
+        /// re-distributed, but the session is kept (without any work) for
+        /// one more grace period so that a client that is only a little
+        /// late doesn't get job IDs that it still holds. After that it is
+        /// forgotten, so a session is parked for at most twice the grace
+        /// period.
+        struct parked_session {
+            remote rmt;
+            std::unique_ptr<boost::asio::steady_timer> expiry;
+            /// The jobs' limiter tokens that are still held by `rmt.work`
+            /// and so are left in the limit until they're released
+            std::size_t reserved = 0;
+            /// Set once the work has been re-distributed
+            bool expired = false;
+        };
+        std::map<uint64_t, parked_session> parked;
+        /// Start the grace period for a parked session
+        void start_expiry(parked_session &, uint64_t session);
+        /// Take the work for a session away from a parked connection, or
+        /// from a connection we hadn't noticed was dead
+        std::optional<remote> take_session(uint64_t session);
+        /// Redistribute the work of a session whose client didn't come
+        /// back in time, or forget the session if that has already been
+        /// done
+        void expire(uint64_t session);
+        /// Moving average of the job time across all connections
+        double remote_mean_time = 0;
+        /// The time (in seconds) `next_job` has spent waiting for queue
+        /// space since the last call to `dispatch_wait`
+        double waiting = 0;
+        /// Connections with spare capacity, ordered by their virtual time
+        std::set<std::tuple<double, int64_t, remote *>> ready;
+        /// Re-calculate a connection's place in `ready`
+        void update_ready(int64_t id, remote &);
+        /// The relative speed of a connection
+        double weight(const remote &) const;
+        /// Retire a job that was done over the network
+        void remote_done(
+                connection &,
+                remote &,
+                uint64_t id,
+                std::optional<std::string_view> result);
+        /// Send our new capacity to the upstream server, if there is one
+        void tell_upstream();
+        /// IDs of the jobs our server has given us that we haven't yet
+        /// reported as done
+        std::unordered_set<uint64_t> holding;
+        /// Jobs completed while there was no connection to our server
+        std::vector<std::tuple<
+                std::string,
+                std::optional<uint64_t>,
+                std::optional<std::string>>>
+                held;
+        /// Jobs that are in flight together with how many times each has
+        /// been submitted. Only used when duplicates are coalesced.
+        std::unordered_map<std::string, std::size_t> in_flight;
 
       public:
         /// The child process pool
         child_pool &pool;
         /// Overspill for the capacity
-        f5::boost_asio::queue<std::string> overspill;
+        spill_queue overspill;
         /// Atomic bool that is set to true when the input is complete
         std::atomic<bool> input_complete{false};
+        /// Called with each job completed over the network, together with
+        /// the number of times it is to be reported, the result payload
+        /// if the worker's result was captured and the ID the job had
+        /// when it was given to `next_job`
+        std::function<void(
+                const std::string &,
+                std::size_t,
+                std::optional<std::string_view>,
+                std::optional<uint64_t>)>
+                report;
+        /// The server we get our work from when relaying work between it
+        /// and our own networked clients
+        weak_connection upstream;
+
+        /// How to deal with jobs identical to one that is still in flight
+        enum class duplicates { run, each, once };
+        duplicates coalesce = duplicates::run;
+        /// Parse the duplicates setting
+        static duplicates duplicate_handling(const fostlib::string &);
 
-        /// Create the initial capacity based on the local workers
+        /// Create the initial capacity based on the local workers that
+        /// are already ready
         capacity(boost::asio::io_service &ios, child_pool &pool);
 
         /// Give this task to a worker when one becomes available
-        void next_job(std::string job, boost::asio::yield_context yield);
-        /// Mark (and count) a job as done
-        void job_done(const std::string &job);
+        void next_job(task job, boost::asio::yield_context yield);
+        /// Returns true if the job is a duplicate of one that is in flight.
+        /// The job must then not be given to `next_job` as it will be
+        /// reported when the original completes.
+        bool coalesced(const std::string &job);
+        /// Mark (and count) a job as done. Returns how many times the
+        /// completed job should be reported.
+        std::size_t job_done(const std::string &job);
+        /// Mark a job done by a local child. The child's queue depth is
+        /// adjusted based on the time that the job took.
+        std::size_t job_done(childproc &child, const job &done);
         /// Mark a network job as having been done
         void job_done(std::shared_ptr<connection> cnx, const std::string &job);
+        /// Mark a number of network jobs as done
+        void
+                job_done(
+                        std::shared_ptr<connection> cnx,
+                        const std::vector<std::string> &jobs);
+        /// Mark a number of network jobs as done using the IDs this
+        /// side gave them
+        void
+                job_done(
+                        std::shared_ptr<connection> cnx,
+                        const std::vector<uint64_t> &ids);
+        /// Mark a number of network jobs as done, together with the result
+        /// payloads their workers returned
+        void
+                job_done(
+                        std::shared_ptr<connection> cnx,
+                        const std::vector<std::pair<uint64_t, std::string>>
+                                &results);
         /// Move all of the outstanding work for the connection to the
         /// over spill and the remove the connection as it is now dead.
         void overspill_work(std::shared_ptr<connection> cnx);
 
         /// Return the limit on the capacity
         auto size() const { return limit.limit(); }
-        /// Return the number of children
-        auto children() const { return pool.children.size(); }
+        /// Return the capacity of the local workers, including children
+        /// that aren't ready yet
+        std::size_t local() const;
+        /// Return the capacity we offer a server. This is the local
+        /// capacity with some overspill, and the capacity of our own
+        /// networked clients
+        std::size_t advertised() const;
+        /// Return the number of local workers
+        std::size_t children() const {
+            return pool.active() + (plugins ? plugins->size() : 0u);
+        }
+        /// A child has started its worker, so its queue can now be used
+        void child_ready(childproc &);
+        /// Start another child and return it so its pipes can be serviced
+        childproc &grow();
+        /// Stop giving the child work. Once its queue is empty its stdin
+        /// is closed so that it exits
+        void retire(childproc &);
+        /// Return how long (in seconds) the dispatcher has waited for
+        /// queue space since the last call
+        double dispatch_wait();
+        /// Run local jobs on these in-process workers
+        void use_plugins(std::unique_ptr<plugin_pool>);
+
+        /// Register a network connection with its capacity. If the client
+        /// is resuming a session its outstanding work is taken over
+        void additional(
+                std::shared_ptr<connection>,
+                uint64_t,
+                std::optional<uint64_t> session = {});
+        /// A client's connection has gone. If it may come back its work is
+        /// kept for the grace period, otherwise it is redistributed
+        void disconnected(std::shared_ptr<connection>);
+        /// A client that has resumed its session has told us which of the
+        /// session's jobs it still has. The others are redistributed
+        void resumed(
+                std::shared_ptr<connection>, const std::vector<uint64_t> &);
 
-        /// Register a network connection with its capacity
-        void additional(std::shared_ptr<connection>, uint64_t);
+        /// A job with this ID has arrived from our server
+        void received(uint64_t id);
+        /// The version has been negotiated with our server
+        void upstream_connected(std::shared_ptr<connection>);
+        /// Report a completed job to our server. If the connection is
+        /// down the report is held until we have reconnected
+        void report_upstream(
+                std::string job,
+                std::optional<uint64_t> id,
+                std::optional<std::string> result);
+        /// Returns true if there are jobs our server still expects to
+        /// hear about
+        bool owes_upstream() const {
+            return not holding.empty() || not held.empty();
+        }
+        /// A network connection's capacity has changed
+        void update(std::shared_ptr<connection>, uint64_t);
 
         /// Returns the amount of work outstanding. A value of zero
         /// doesn't mean that no more work can be requested, only that
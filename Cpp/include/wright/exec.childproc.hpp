@@ -13,10 +13,15 @@
 #include <fost/counter>
 #include <fost/timer>
 
+#include <wright/line_reader.hpp>
 #include <wright/pipe.hpp>
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
+#include <deque>
+#include <memory>
+
 
 namespace wright {
 
@@ -25,7 +30,8 @@ namespace wright {
     struct child_pool;
 
 
-    /// The buffer size for each child
+    /// The starting buffer size for each child. The queue depth is then
+    /// adjusted as job times are measured.
     const std::size_t buffer_size = 3;
 
 
@@ -33,16 +39,53 @@ namespace wright {
     void fork_worker();
 
 
+    /// The signals the manager uses to control the process supervisor
+    /// (the child). `SIGUSR1` kills the supervisor's current worker,
+    /// because its output is out of step and can't be read. With the
+    /// framed protocol a supervisor whose worker has died waits for
+    /// `SIGUSR2` before starting another one. The manager sends it once it
+    /// has thrown away anything left of a job in the worker's stdin.
+    namespace child_signals {
+        /// Set up the signal handling in the process supervisor
+        void install();
+        /// Record the worker that `SIGUSR1` kills. Zero for none
+        void worker(int pid);
+        /// Undo the signal handling in a newly forked process before it
+        /// starts the worker (or zygote)
+        void reset();
+        /// Wait for the manager to say that a new worker can start
+        void await_resync();
+    }
+
+
+    /// Work that is waiting to be given to a worker
+    struct task {
+        std::string command;
+        /// The ID the server knows the job by, if it arrived over the
+        /// network
+        std::optional<uint64_t> id = {};
+    };
+
+
     struct job {
         std::string command;
         std::shared_ptr<f5::fd::limiter::job> limiter;
         fostlib::timer time;
+        std::optional<uint64_t> id = {};
+        /// The ID the worker knows the job by when the framed protocol is
+        /// used
+        uint64_t sequence = 0;
+        /// The payload the worker returned, if results are being captured
+        std::optional<std::string> result = {};
     };
 
 
     struct childproc final : boost::noncopyable {
         pipe_in stdin;
-        pipe_out stdout, stderr, resend;
+        pipe_out stdout, stderr;
+        /// Only used when there is a process supervisor between us and the
+        /// worker
+        std::optional<pipe_out> resend;
 
         /// The child number
         const std::size_t number;
@@ -56,44 +99,117 @@ namespace wright {
         std::unique_ptr<counter_store> counters;
         /// The command line argument list for the child process
         fostlib::string argx;
+        std::vector<fostlib::string> argvs;
         std::vector<char const *> argv;
         /// The string version of the backchannel FD
         std::string backchannel_fd;
         /// The PID that the child gets
         int pid;
-        /// The current queue
+        /// Set once the child has told us its worker has started. Until
+        /// then it is given no work and its queue isn't part of the
+        /// capacity limit
+        bool ready = false;
+        /// Set when the pool is shrinking and this child is to finish its
+        /// queued jobs and then exit
+        bool retiring = false;
+        /// The number of scaling intervals the child has had nothing to do
+        std::size_t idle_intervals = 0;
+        /// The number of coroutines that are still serving the child. A
+        /// retired child's slot can only be re-used once they have all
+        /// finished
+        std::atomic<std::size_t> serving = 0;
+        /// The number of jobs the worker runs at the same time
+        const std::size_t concurrency;
+        /// The number of writes to the worker's stdin still in progress.
+        /// Writes are made one at a time, so this is never more than one
+        std::size_t writing = 0;
+        /// Incremented each time the worker is replaced. Output read from
+        /// the worker across a change belongs to the old worker
+        uint64_t generation = 0;
+        /// The current queue. The first `concurrency` jobs are the ones
+        /// the worker is expected to be running
         boost::circular_buffer<job> commands;
+        /// The sequence number for the next job sent to the child
+        uint64_t next_sequence = 0;
+        /// The number of jobs we currently want queued for this child
+        std::size_t depth;
+        /// Moving average of the time the child takes per job (in seconds).
+        /// For a worker that runs jobs concurrently this is the time per
+        /// job, not the time each job spends in the worker.
+        double mean_time = 0;
+
+        /// Returns true if the child has no jobs queued and none are part
+        /// way through being written to it, so its stdin can be closed
+        bool idle() const { return commands.empty() && not writing; }
+        /// Returns true if the child shouldn't be given any more work
+        bool full() const {
+            return not ready || retiring || commands.size() >= depth;
+        }
+        /// Record how long a job took and re-calculate the queue depth.
+        /// Returns the change in the depth.
+        int64_t record_time(double seconds);
 
         childproc(std::size_t n, const char *);
         childproc(childproc &&);
         ~childproc() { close(); }
 
-        /// Execute the process. Perform the clean up before making the execvpe
-        /// call
-        template<typename F>
-        void fork_exec(F tidy) {
-            pid = ::fork();
-            if (pid < 0) {
-                throw std::system_error(errno, std::system_category());
-            } else if (pid == 0) {
-                dup2(stdin.child(), STDIN_FILENO);
-                dup2(stdout.child(), STDOUT_FILENO);
-                dup2(stderr.child(), STDERR_FILENO);
-                tidy();
-                ::execvp(argv.front(), const_cast<char *const *>(argv.data()));
-            }
-        }
+        /// Count a coroutine that serves the child until the returned
+        /// handle (and all copies of it) have gone
+        std::shared_ptr<void> in_use();
+        /// Make a retired child's slot ready for a new worker process. It
+        /// gets new pipes and starts again as if it had just been
+        /// constructed, but keeps its number and counters
+        void renew();
+
+        /// Execute the process using `posix_spawnp`. The pipe ends are
+        /// given to the child by file actions and every other descriptor
+        /// is close on exec, so nothing has to be tidied up in the child
+        /// and the parent's pages are never copied.
+        void spawn();
 
-        /// Send a job to the child
+        /// Start a replacement for a worker that has died and give it the
+        /// jobs that were queued for the old one. Only used for direct
+        /// supervision
+        void
+                restart(boost::asio::io_service &ctrlios,
+                        boost::asio::yield_context yield);
+        /// Throw away anything left in the worker's stdin once any write
+        /// in progress has finished, so that a new worker starts reading
+        /// at the beginning of a framed record. Anything the old worker
+        /// left in its stdout is thrown away too. Must be called after the
+        /// old worker has gone and before the new one starts
+        void
+                resync(boost::asio::io_service &ctrlios,
+                       boost::asio::yield_context yield);
+        /// Write all of the queued jobs to the child again
+        void resend_jobs(
+                boost::asio::io_service &ctrlios,
+                boost::asio::yield_context yield);
+
+        /// Send a job to the child. Waits for any other write to the child
+        /// to finish first, so that records are never interleaved
         void
                 write(boost::asio::io_service &ios,
-                      const std::string &command,
+                      const job &,
                       boost::asio::yield_context yield);
+        /// Find the queued job that a result is for. Results from workers
+        /// that run one job at a time must be for the job at the front of
+        /// the queue, otherwise the job can be anywhere in the queue
+        std::optional<std::size_t> find_job(std::string_view result) const;
+        std::optional<std::size_t> find_job(uint64_t sequence) const;
+
         /// Read the job that the child has done
         std::string
                 read(boost::asio::io_service &ios,
-                     boost::asio::streambuf &buffer,
+                     line_reader &lines,
                      boost::asio::yield_context yield);
+        /// Read the next record from a child using the framed protocol.
+        /// The payload is only valid until the next read
+        std::optional<frame>
+                read_frame(
+                        boost::asio::io_service &ios,
+                        line_reader &lines,
+                        boost::asio::yield_context yield);
 
         /// Handle requests from the child
         void handle_child_requests(
@@ -109,7 +225,7 @@ namespace wright {
                 boost::asio::io_service &ctrlios,
                 boost::asio::yield_context yield,
                 child_pool &pool,
-                std::function<void(const std::string &)> job_done);
+                std::function<void(const job &)> job_done);
 
         /// Close the pipes
         void close();
@@ -117,14 +233,30 @@ namespace wright {
 
 
     struct child_pool {
-        /// Construct the pool with the specified number of children
+        /// Construct the pool with the specified number of children. The
+        /// children are started from several threads at once, and each
+        /// is only given work once it reports that it is ready
         child_pool(std::size_t number, const char *command);
 
-        /// Start child signal processing
-        void sigchild_handling(boost::asio::io_service &ios);
+        /// Start another child. It isn't ready until it says so. The slot
+        /// of a retired child is re-used if nothing is serving it any more,
+        /// so the pool only grows beyond its largest size while retired
+        /// children are finishing
+        childproc &add();
+        /// The number of children that haven't been retired
+        std::size_t active() const;
+
+        /// Start child signal processing. This runs on the control reactor
+        /// because with direct supervision it restarts workers and resends
+        /// their queues
+        void sigchild_handling(boost::asio::io_service &ctrlios, capacity &);
 
-        /// The children
-        std::vector<childproc> children;
+        /// The command used to start the children
+        const char *command;
+        /// The children. Adding children doesn't move the existing ones,
+        /// and retired children are left in place so that a child's index
+        /// never changes
+        std::deque<childproc> children;
         /// We want to store statistics about the work done
         fostlib::time_profile<std::chrono::milliseconds> job_times;
     };
@@ -0,0 +1,52 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <optional>
+#include <string>
+
+
+namespace wright {
+
+
+    /// A file of jobs, one per line, that has been memory mapped. This lets
+    /// the manager read jobs directly from a regular file, and to count
+    /// them up front so that progress can be reported.
+    class mapped_input final {
+        const char *base = nullptr;
+        std::size_t size = 0u, position = 0u;
+
+      public:
+        /// Map the file open on the descriptor. The descriptor can be
+        /// closed once this returns.
+        explicit mapped_input(int fd);
+        ~mapped_input();
+
+        mapped_input(mapped_input &&m)
+        : base(m.base), size(m.size), position(m.position) {
+            m.base = nullptr;
+        }
+        mapped_input(const mapped_input &) = delete;
+        mapped_input &operator=(const mapped_input &) = delete;
+
+        /// Returns the mapped input if `fd` is a regular file, otherwise
+        /// returns an empty optional
+        static std::optional<mapped_input> if_regular(int fd);
+
+        /// Count the number of jobs in the file
+        std::size_t count() const;
+
+        /// Return the next job, without its newline and with any NUL bytes
+        /// removed. Returns an empty optional at the end of the file.
+        std::optional<std::string> next();
+    };
+
+
+}
@@ -0,0 +1,78 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <wright/job_key.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace wright {
+
+
+    /// A write-ahead journal of the jobs that the manager has accepted and
+    /// completed. If the manager dies a new one can replay the journal and
+    /// skip the jobs that were already done.
+    ///
+    /// Records are written and synced to disk by a thread of their own. All
+    /// of the records that arrive while one sync is running are committed
+    /// together by the next one, so the journal never holds up dispatch.
+    class journal final {
+        struct record {
+            uint64_t kind;
+            job_key key;
+        };
+        const std::string filename;
+        int fd = -1;
+        std::mutex mutex;
+        std::condition_variable signal;
+        std::vector<record> pending;
+        bool closing = false;
+        /// Jobs completed by earlier runs that haven't been seen again yet
+        std::unordered_map<job_key, std::size_t> done;
+        std::thread writer;
+
+        void replay();
+        void add(uint64_t kind, job_key key, std::size_t times);
+        void write_loop();
+
+      public:
+        /// Open the journal. If `resume` is false any existing journal is
+        /// discarded, otherwise it is replayed.
+        journal(std::string filename, bool resume);
+        ~journal() { close(); }
+
+        /// Returns true if the job was completed by an earlier run. Each
+        /// completion is only matched once, so repeated jobs in the input
+        /// are still run as often as they were before.
+        bool completed_before(std::string_view job);
+
+        /// Record that a job has been accepted from the input
+        void accepted(std::string_view job) {
+            add('a', job_key::make(job), 1u);
+        }
+        /// Record that a job has been completed. This must only be done
+        /// once its output has been written, otherwise a resumed run would
+        /// skip a job whose output was lost.
+        void completed(job_key key, std::size_t times = 1u) {
+            add('c', key, times);
+        }
+
+        /// Commit all outstanding records and stop the writer
+        void close();
+    };
+
+
+}
@@ -0,0 +1,63 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace wright {
+
+
+    /// Collects completed jobs and writes them to a file descriptor in
+    /// large blocks. The writes happen on a thread of their own so that a
+    /// slow consumer of the output can't stall the control reactor. It is
+    /// up to the caller to stop producing more output while `backed_up`.
+    class result_writer final {
+        const int fd;
+        std::mutex mutex;
+        std::condition_variable signal;
+        std::string pending;
+        /// Called once the output that was pending when they were added
+        /// has been written
+        std::vector<std::function<void()>> after_write;
+        bool closing = false;
+        std::thread writer;
+
+        void write_loop();
+
+      public:
+        /// Start writing to the file descriptor
+        explicit result_writer(int fd);
+        /// Flushes any remaining output
+        ~result_writer() { close(); }
+
+        /// Queue a completed job to be written `times` times. This never
+        /// blocks. `written` is called from the writer thread once the
+        /// output has been written
+        void
+                write(std::string_view job,
+                      std::size_t times = 1u,
+                      std::function<void()> written = {});
+        /// True while the output waiting to be written is over the high
+        /// water mark
+        bool backed_up();
+
+        /// Write everything that is outstanding and stop the writer thread
+        void close();
+    };
+
+
+}
@@ -0,0 +1,72 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <wright/exec.childproc.hpp>
+#include <wright/plugin.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace wright {
+
+
+    /// Runs jobs inside this process on a pool of threads, using the
+    /// `wright_job` function exported by a shared library. This avoids the
+    /// pipe round trips needed to give a job to a worker process, so it
+    /// suits very short jobs.
+    class plugin_pool final {
+        boost::asio::io_service &ios;
+        void *library;
+        decltype(&wright_job) entry;
+        std::function<void(const job &)> done, failed;
+
+        std::mutex mutex;
+        std::condition_variable signal;
+        std::deque<job> queue;
+        bool closing = false;
+        std::vector<std::thread> threads;
+
+        void work_loop();
+
+      public:
+        /// Load the library and start the threads. `done` is called on the
+        /// `ios` reactor with each completed job, and `failed` with each
+        /// job that still failed after all of its retries
+        plugin_pool(
+                boost::asio::io_service &ios,
+                const std::string &filename,
+                std::size_t threads,
+                std::function<void(const job &)> done,
+                std::function<void(const job &)> failed);
+        plugin_pool(const plugin_pool &) = delete;
+        plugin_pool &operator=(const plugin_pool &) = delete;
+        ~plugin_pool();
+
+        /// The number of threads running jobs
+        std::size_t size() const { return threads.size(); }
+        /// The number of jobs that may be waiting for, or running on, the
+        /// threads
+        std::size_t capacity() const;
+
+        /// Queue a job to be run
+        void execute(job);
+
+        /// Finish the outstanding jobs and stop the threads
+        void close();
+    };
+
+
+}
@@ -0,0 +1,44 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <fost/core>
+
+#include <memory>
+#include <optional>
+
+
+namespace wright {
+
+
+    struct child_pool;
+
+
+    /// A policy that decides which local child is given the next job
+    class scheduler {
+      public:
+        virtual ~scheduler() = default;
+
+        /// Return the index of the child that is to be given the next job,
+        /// or nothing if no child has space in its queue. That can happen
+        /// briefly when the slot was held by a network connection that is
+        /// closing.
+        virtual std::optional<std::size_t> select() = 0;
+        /// Tell the scheduler that the queue or timings for a child have
+        /// changed
+        virtual void changed(std::size_t child) {}
+
+        /// Create the scheduler named by the setting
+        static std::unique_ptr<scheduler>
+                make(const fostlib::string &name, child_pool &);
+    };
+
+
+}
@@ -0,0 +1,65 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace wright {
+
+
+    /// The environment variable that gives a worker started as a zygote
+    /// the file descriptor of its control channel
+    constexpr char const zygote_fd_variable[] = "WRIGHT_ZYGOTE_FD";
+
+
+    /// A blocking, line based, control channel between a child process
+    /// and its zygote. The zygote sends `ready` once it has warmed up. The
+    /// child then sends `fork` whenever it needs a new worker and the
+    /// zygote answers with `pid N` once the worker has been forked and
+    /// `exit N STATUS` when it has been reaped.
+    class zygote_channel final {
+        int fd;
+        std::string buffer;
+
+      public:
+        explicit zygote_channel(int fd) : fd(fd) {}
+        zygote_channel(const zygote_channel &) = delete;
+        zygote_channel &operator=(const zygote_channel &) = delete;
+        ~zygote_channel() { close(); }
+
+        /// Read the next line. Returns an empty optional when the other
+        /// end has gone away
+        std::optional<std::string> read();
+        /// Write a line. Returns false if the other end has gone away
+        bool write(std::string_view);
+
+        void close();
+    };
+
+
+    /// Workers call this once they have finished their (expensive) start
+    /// up and are ready to read jobs from stdin. If the worker was started
+    /// as a zygote then this serves fork requests and only returns in the
+    /// freshly forked workers. Otherwise it returns straight away.
+    ///
+    /// Anything buffered for stdout must be flushed before the call, and
+    /// stdin must not have been read from yet.
+    void zygote();
+
+
+    /// The child process loop used when the worker runs as a zygote
+    void zygote_worker(const std::vector<char const *> &argv);
+
+
+}
@@ -0,0 +1,63 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+
+namespace wright {
+
+
+    /// The framed worker protocol sends each job, and each result, as a
+    /// record made up of a header and a payload. The header is the payload
+    /// length (32 bits) followed by the job ID (64 bits), both in the
+    /// machine's native byte order. The payload can contain any bytes.
+    constexpr std::size_t frame_header_size = 12u;
+    /// The largest payload a record may have. A header announcing more
+    /// than this can only come from a stream that is out of step, for
+    /// example because a worker printed something to stdout without
+    /// framing it.
+    constexpr std::size_t frame_payload_max = 64u << 20;
+
+    /// Thrown when a header can't be the start of a record
+    struct frame_error : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    /// A record read in the framed protocol
+    struct frame {
+        uint64_t id;
+        std::string_view payload;
+    };
+
+    /// Build the header for a record
+    std::array<char, frame_header_size>
+            frame_header(uint64_t id, std::size_t length);
+    /// Decode a header. Returns the payload length and the job ID. Throws
+    /// `frame_error` if the length is more than `frame_payload_max`
+    std::pair<std::size_t, uint64_t> frame_header(const char *header);
+
+
+    /// Used by workers to read the next job. Returns false at the end of
+    /// the stream
+    bool read_frame(std::istream &, uint64_t &id, std::string &payload);
+    /// Used by workers to write a result. The record is sent to the stream
+    /// as a single write, so it should go straight to an unbuffered file
+    /// descriptor or be flushed.
+    void write_frame(std::ostream &, uint64_t id, std::string_view payload);
+
+
+}
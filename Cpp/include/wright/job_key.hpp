@@ -0,0 +1,51 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <tuple>
+
+
+namespace wright {
+
+
+    /// A 128 bit content hash used to identify a job on disk
+    struct job_key {
+        uint64_t high = 0, low = 0;
+
+        /// Hash the job text together with a fingerprint. The fingerprint
+        /// lets the user invalidate keys when something other than the job
+        /// text (e.g. a compiler version) changes the result.
+        static job_key
+                make(std::string_view job, std::string_view fingerprint = {});
+
+        bool operator==(const job_key &k) const {
+            return high == k.high && low == k.low;
+        }
+        bool operator!=(const job_key &k) const { return not(*this == k); }
+        bool operator<(const job_key &k) const {
+            return std::tie(high, low) < std::tie(k.high, k.low);
+        }
+    };
+
+
+}
+
+
+namespace std {
+    template<>
+    struct hash<wright::job_key> {
+        std::size_t operator()(const wright::job_key &k) const {
+            return k.low;
+        }
+    };
+}
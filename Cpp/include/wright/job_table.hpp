@@ -0,0 +1,133 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+
+namespace wright {
+
+
+    /// Stores outstanding work against compact 64 bit IDs. The low 32 bits
+    /// of the ID are an index into a flat slot array and the high 32 bits
+    /// are a generation count for the slot, so a stale ID will never
+    /// retire a newer job that happens to re-use the same slot. Insertion,
+    /// lookup and removal are all O(1).
+    template<typename V>
+    class job_table final {
+        struct slot {
+            uint32_t generation = 0;
+            std::optional<V> value;
+        };
+        std::vector<slot> slots;
+        std::vector<uint32_t> unused;
+        std::size_t count = 0;
+
+        slot *lookup(uint64_t id) {
+            const auto index = static_cast<uint32_t>(id);
+            if (index >= slots.size()) return nullptr;
+            auto &s = slots[index];
+            if (not s.value || s.generation != (id >> 32)) return nullptr;
+            return &s;
+        }
+
+      public:
+        /// Store the value and return the ID it can be found by
+        uint64_t insert(V v) {
+            uint32_t index;
+            if (unused.empty()) {
+                index = slots.size();
+                slots.emplace_back();
+            } else {
+                index = unused.back();
+                unused.pop_back();
+            }
+            auto &s = slots[index];
+            s.value.emplace(std::move(v));
+            ++count;
+            return (uint64_t{s.generation} << 32) | index;
+        }
+
+        /// Return a pointer to the value, or `nullptr` if the ID isn't
+        /// outstanding
+        V *find(uint64_t id) {
+            auto s = lookup(id);
+            return s ? &*s->value : nullptr;
+        }
+
+        /// Remove the value and return it
+        std::optional<V> erase(uint64_t id) {
+            std::optional<V> ret;
+            if (auto s = lookup(id); s) {
+                ret.swap(s->value);
+                ++s->generation;
+                unused.push_back(static_cast<uint32_t>(id));
+                --count;
+            }
+            return ret;
+        }
+
+        /// Return the ID of the first value that satisfies the predicate
+        template<typename P>
+        std::optional<uint64_t> find_if(P pred) const {
+            for (std::size_t index{}; index < slots.size(); ++index) {
+                auto const &s = slots[index];
+                if (s.value && pred(*s.value)) {
+                    return (uint64_t{s.generation} << 32) | index;
+                }
+            }
+            return {};
+        }
+
+        /// Call the function for each of the outstanding values
+        template<typename F>
+        void for_each(F fn) {
+            for (auto &s : slots) {
+                if (s.value) fn(*s.value);
+            }
+        }
+
+        /// Remove all of the values, passing each to the function. The
+        /// IDs they had will never be valid again
+        template<typename F>
+        void drain(F fn) {
+            for (std::size_t index{}; index < slots.size(); ++index) {
+                auto &s = slots[index];
+                if (not s.value) continue;
+                fn(std::move(*s.value));
+                s.value.reset();
+                ++s.generation;
+                unused.push_back(index);
+            }
+            count = 0;
+        }
+
+        /// Return the IDs of all of the outstanding values
+        std::vector<uint64_t> ids() const {
+            std::vector<uint64_t> ret;
+            ret.reserve(count);
+            for (std::size_t index{}; index < slots.size(); ++index) {
+                if (slots[index].value) {
+                    ret.push_back(
+                            (uint64_t{slots[index].generation} << 32) | index);
+                }
+            }
+            return ret;
+        }
+
+        /// The number of outstanding values
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0u; }
+    };
+
+
+}
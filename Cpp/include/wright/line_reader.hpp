@@ -0,0 +1,62 @@
+/**
+    Copyright 2016-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <wright/frame.hpp>
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/spawn.hpp>
+
+
+namespace wright {
+
+
+    /// Splits a byte stream into newline separated lines. Data is read in
+    /// large blocks and scanned with `memchr`, so there is no per-character
+    /// work unless a line contains NUL bytes (which are dropped).
+    ///
+    /// The same buffering is used to split the stream into records when
+    /// the framed worker protocol is used. Then only the header is looked
+    /// at and the payload is passed on untouched.
+    class line_reader final {
+        std::vector<char> buffer;
+        /// The unread data is in the range [start, end)
+        std::size_t start = 0u, end = 0u;
+
+      public:
+        /// The size of the blocks that are read
+        static constexpr std::size_t block_size = 64u << 10;
+
+        line_reader();
+
+        /// Return the next complete line, without its newline. The view is
+        /// only valid until the next call to `fill`.
+        std::optional<std::string_view> next();
+        /// Return the next complete framed record. The payload view is
+        /// only valid until the next call to `fill`. Throws `frame_error`
+        /// if the stream is out of step.
+        std::optional<frame> next_frame();
+
+        /// Read more data into the buffer. Returns the number of bytes read.
+        std::size_t
+                fill(boost::asio::posix::stream_descriptor &,
+                     boost::asio::yield_context);
+
+        /// Any partial line left in the buffer. Used once the stream has
+        /// ended. This also empties the buffer.
+        std::string_view remainder();
+    };
+
+
+}
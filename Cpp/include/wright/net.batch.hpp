@@ -0,0 +1,69 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <vector>
+
+
+namespace wright {
+
+
+    /// Collects items together so that they can be sent over the network
+    /// in a single packet. The batch is flushed when it reaches the size
+    /// threshold, or when the time window since the first item was added
+    /// expires, whichever happens first.
+    ///
+    /// All of the calls must be made from the same (single threaded)
+    /// reactor that the timer uses. The `flush` function passed to `add`
+    /// must keep the owner of the batch alive.
+    template<typename T>
+    class batch final {
+        std::vector<T> items;
+        boost::asio::steady_timer timer;
+
+      public:
+        batch(boost::asio::io_service &ios) : timer(ios) {}
+
+        /// Add an item to the batch
+        template<typename F>
+        void
+                add(T item,
+                    std::size_t threshold,
+                    std::chrono::milliseconds window,
+                    F flush) {
+            items.push_back(std::move(item));
+            if (items.size() >= threshold) {
+                timer.cancel();
+                flush(take());
+            } else if (items.size() == 1u) {
+                timer.expires_from_now(window);
+                timer.async_wait([this, flush](boost::system::error_code error) {
+                    if (not error && not items.empty()) flush(take());
+                });
+            }
+        }
+
+        /// Remove all of the items from the batch
+        std::vector<T> take() {
+            std::vector<T> ret;
+            ret.swap(items);
+            return ret;
+        }
+
+        /// The number of items waiting to be sent
+        std::size_t size() const { return items.size(); }
+    };
+
+
+}
@@ -9,9 +9,13 @@
 #pragma once
 
 
+#include <wright/exec.childproc.hpp>
+#include <wright/net.batch.hpp>
+
 #include <fost/hod/protocol>
 #include <f5/threading/queue.hpp>
 
+#include <atomic>
 #include <future>
 
 
@@ -27,6 +31,17 @@ namespace wright {
     public fostlib::hod::tcp_connection,
             public std::enable_shared_from_this<connection> {
         std::promise<void> blocker;
+        /// Set once the remote end has gone
+        bool lost = false;
+        /// Set once we've warned that the remote end is too old to be sent
+        /// the workers' results
+        std::atomic<bool> warned_results = false;
+        /// Jobs waiting to be sent to the remote end
+        batch<task> executes;
+        /// Completed jobs waiting to be reported to the remote end
+        batch<std::string> completions;
+        batch<uint64_t> completed_ids;
+        batch<std::pair<uint64_t, std::string>> completed_results;
 
       public:
         /// The outbound queue for this connection
@@ -40,8 +55,31 @@ namespace wright {
         connection(
                 boost::asio::io_service &ios, peering p, wright::capacity &cap);
 
+        /// Send a job to the remote end for execution. If the negotiated
+        /// protocol version allows it then jobs are batched together
+        /// into a single packet.
+        void execute(task job);
+        /// Report a completed job to the remote end. Completions are
+        /// batched in the same way as jobs are. If the server gave the
+        /// job an ID then only the ID is sent back, together with the
+        /// worker's result if there is one. Servers older than protocol
+        /// version 5 can't be sent results, so they are dropped with a
+        /// warning.
+        void completed(
+                std::string job,
+                std::optional<uint64_t> id,
+                std::optional<std::string> result = {});
+
         /// Block waiting for the connection to close
         void wait_for_close();
+        /// Returns true once the remote end has gone. Must be called from
+        /// the connection's reactor
+        bool closed() const { return lost; }
+
+        /// The ID a client uses for its session with the server. It is
+        /// the same for every connection the process makes, so a server
+        /// can tell when a lost client has reconnected
+        static uint64_t session_id();
 
         /// Broadcast a message to all connections
         static std::size_t
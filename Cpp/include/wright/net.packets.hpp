@@ -22,8 +22,15 @@ namespace wright {
     namespace packet {
         enum control_numbers {
             version = 0x80,
+            capacity_update = 0x81,
+            session_resume = 0x82,
             execute = 0x90,
             completed = 0x91,
+            execute_batch = 0x92,
+            completed_batch = 0x93,
+            execute_ids = 0x94,
+            completed_ids = 0x95,
+            completed_results = 0x96,
             log_message = 0xe0
         };
     }
@@ -38,14 +45,45 @@ namespace wright {
                 version(std::shared_ptr<connection> cnx,
                         fostlib::hod::tcp_decoder &decode);
 
+        /// The remote end's capacity has changed
+        void capacity_update(
+                std::shared_ptr<connection> cnx,
+                fostlib::hod::tcp_decoder &decode);
+
+        /// A client has told us which of its session's jobs it still has
+        void session_resume(
+                std::shared_ptr<connection> cnx,
+                fostlib::hod::tcp_decoder &decode);
+
         /// A job has been recived
         void
                 execute(std::shared_ptr<connection> cnx,
                         fostlib::hod::tcp_decoder &decode);
+        /// A number of jobs have been received
+        void execute_batch(
+                std::shared_ptr<connection> cnx,
+                fostlib::hod::tcp_decoder &decode);
+        /// A number of jobs, each with an ID, have been received
+        void execute_ids(
+                std::shared_ptr<connection> cnx,
+                fostlib::hod::tcp_decoder &decode);
         /// A job has been completed
         void completed(
                 std::shared_ptr<connection> cnx,
                 fostlib::hod::tcp_decoder &decode);
+        /// A number of jobs have been completed
+        void completed_batch(
+                std::shared_ptr<connection> cnx,
+                fostlib::hod::tcp_decoder &decode);
+        /// A number of jobs, identified by ID, have been completed
+        void completed_ids(
+                std::shared_ptr<connection> cnx,
+                fostlib::hod::tcp_decoder &decode);
+        /// A number of jobs, identified by ID, have been completed and
+        /// their results returned
+        void completed_results(
+                std::shared_ptr<connection> cnx,
+                fostlib::hod::tcp_decoder &decode);
 
         /// Log message
         void log_message(
@@ -61,11 +99,25 @@ namespace wright {
 
 
         /// Create a version packet
-        fostlib::hod::out_packet version(capacity &);
+        /// Create a version packet. A client includes its session ID
+        fostlib::hod::out_packet
+                version(capacity &, std::optional<uint64_t> session = {});
+        /// Tell the remote end our capacity has changed
+        fostlib::hod::out_packet capacity_update(uint64_t);
+        /// Tell the server which jobs we still have after reconnecting
+        fostlib::hod::out_packet session_resume(std::vector<uint64_t>);
 
         /// Send a job over the wire
         fostlib::hod::out_packet execute(std::string);
+        /// Send several jobs over the wire in one packet
+        fostlib::hod::out_packet execute(std::vector<std::string>);
+        /// Send several jobs together with their IDs
+        fostlib::hod::out_packet execute(std::vector<task>);
         fostlib::hod::out_packet completed(const std::string &);
+        fostlib::hod::out_packet completed(std::vector<std::string>);
+        fostlib::hod::out_packet completed_ids(std::vector<uint64_t>);
+        fostlib::hod::out_packet
+                completed(std::vector<std::pair<uint64_t, std::string>>);
 
         /// Log message
         fostlib::hod::out_packet log_message(const fostlib::log::message &m);
@@ -20,12 +20,16 @@ namespace wright {
     namespace detail {
 
 
-        /// Return two pipe filedescriptors
+        /// Return two pipe filedescriptors. Both are close on exec, so
+        /// child processes only get the ends they are explicitly given
         std::pair<int, int> pipe_fds(std::size_t, std::size_t);
-        /// Duplicate a file descriptor
+        /// Duplicate a file descriptor (also close on exec)
         int dup(int);
         /// Close the file descriptor and set to zer
         int close(int &fd);
+        /// Read and throw away anything waiting in the pipe. Returns the
+        /// number of bytes discarded
+        std::size_t discard(int fd);
 
         /// A pipe for use between a parent process and its child. The
         /// direction of the pipe is controlled by the template parameters.
@@ -49,6 +53,13 @@ namespace wright {
                 p.parent_fd = 0;
                 p.child_fd = 0;
             }
+            pipe &operator=(pipe &&p) {
+                close();
+                parent_fd = std::exchange(p.parent_fd, 0);
+                parent_sd = std::move(p.parent_sd);
+                child_fd = std::exchange(p.child_fd, 0);
+                return *this;
+            }
             /// Close the file handles
             ~pipe() { close(); }
             /// Close the file handles
@@ -58,6 +69,10 @@ namespace wright {
                 detail::close(child_fd);
             }
 
+            /// Close only the child end, so that the parent end sees end of
+            /// file once the child process has gone
+            void close_child() { detail::close(child_fd); }
+
             /// Return a copy of the descriptor for the child end. Should be
             /// passed dup2 to set up child end of pipe.
             int child() const { return child_fd; }
@@ -0,0 +1,38 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <stddef.h>
+
+
+/// The interface a shared library must export to be used for in-process
+/// workers (`--plugin`). The library is loaded with `dlopen` and the job
+/// function is called concurrently from several threads, so it must be
+/// thread safe.
+extern "C" {
+
+
+/// Passed to the job function so that it can return a result payload. It
+/// may be called any number of times and the data is appended to the
+/// result. The data is copied before the call returns.
+typedef void (*wright_result)(void *context, const char *data, size_t length);
+
+
+/// Run a single job. Return zero if the job succeeded. A job that fails is
+/// run again, up to the `Plugin retries` setting (`--plugin-retries`)
+/// times. If it still fails the failure is logged and counted, but the job
+/// is not written to the output, the result cache or the journal, so it
+/// will be run again by a later run. A networked client can't report the
+/// failure to its server, so it exits instead.
+int wright_job(
+        const char *job, size_t length, wright_result result, void *context);
+
+
+}
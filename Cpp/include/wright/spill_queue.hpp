@@ -0,0 +1,65 @@
+/**
+    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <wright/exec.childproc.hpp>
+
+#include <f5/threading/queue.hpp>
+
+
+namespace wright {
+
+
+    /// A queue of tasks with a bounded memory budget. Once the tasks held
+    /// in memory reach the budget further tasks are written to a spool
+    /// file on disk. They are read back, in order, as the tasks in memory
+    /// are consumed. The order of all tasks is preserved.
+    ///
+    /// The queue must only be used from a single threaded reactor.
+    class spill_queue final {
+        f5::boost_asio::queue<task> memory;
+        /// The number of tasks and bytes that are in memory
+        std::size_t in_memory = 0u, bytes = 0u;
+        /// The spool file. Tasks are appended at `write_offset` and read
+        /// from `read_offset`.
+        int fd = -1;
+        std::size_t spooled = 0u, read_offset = 0u, write_offset = 0u;
+
+        static std::size_t cost(const task &t) {
+            return sizeof(task) + t.command.size();
+        }
+        void spool(const task &);
+        /// Move tasks from the spool file into memory while they fit
+        void refill();
+        /// Account for a task that has been taken out of memory
+        task taken(task);
+
+      public:
+        spill_queue(boost::asio::io_service &);
+        ~spill_queue();
+
+        spill_queue(const spill_queue &) = delete;
+        spill_queue &operator=(const spill_queue &) = delete;
+
+        /// Add a task to the end of the queue
+        void produce(task);
+        /// Wait for the next task
+        task consume(boost::asio::yield_context);
+        /// Return the next task if there is one
+        std::optional<task> consume();
+
+        /// True if there are no tasks either in memory or on disk
+        bool empty() const { return in_memory == 0u && spooled == 0u; }
+        /// The number of tasks currently written to disk
+        std::size_t on_disk() const { return spooled; }
+    };
+
+
+}
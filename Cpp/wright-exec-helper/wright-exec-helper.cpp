@@ -50,10 +50,29 @@ int main(int argc, char *argv[]) {
                 configuration.emplace_back(std::move(filename));
             }
             /// Process the command switches that alter behaviour
+            args.commandSwitch("-cache", wright::c_cache);
+            args.commandSwitch(
+                    "-cache-fingerprint", wright::c_cache_fingerprint);
+            args.commandSwitch("-direct", wright::c_direct_supervision);
+            args.commandSwitch("-framed", wright::c_framed);
+            args.commandSwitch("-input", wright::c_input);
+            args.commandSwitch("-journal", wright::c_journal);
+            args.commandSwitch("-max-children", wright::c_children_max);
+            args.commandSwitch("-resume", wright::c_journal_resume);
+            args.commandSwitch("-results", wright::c_results);
             args.commandSwitch("p", wright::c_port);
+            args.commandSwitch("-plugin", wright::c_plugin);
+            args.commandSwitch("-plugin-retries", wright::c_plugin_retries);
+            args.commandSwitch("-plugin-threads", wright::c_plugin_threads);
+            args.commandSwitch("-relay", wright::c_relay_port);
             args.commandSwitch("rfd", wright::c_resend_fd);
+            args.commandSwitch("-scale-interval", wright::c_scale_interval);
+            args.commandSwitch("-session-grace", wright::c_session_grace);
             args.commandSwitch("w", wright::c_children);
             args.commandSwitch("x", wright::c_exec);
+            args.commandSwitch(
+                    "-worker-concurrency", wright::c_worker_concurrency);
+            args.commandSwitch("-zygote", wright::c_zygote);
             /// Load the standard settings
             fostlib::standard_arguments(settings, std::cerr, args);
             /// Start the logging
@@ -74,6 +93,7 @@ int main(int argc, char *argv[]) {
                 if (wright::c_simulate.value()) {
                     /// These switches are used by the simulator
                     args.commandSwitch("d", wright::c_can_die);
+                    args.commandSwitch("-framed", wright::c_framed);
                     args.commandSwitch("-sim-mean", wright::c_sim_mean);
                     args.commandSwitch("-sim-sd", wright::c_sim_sd);
                     /// Simulate work by sleeping, and also keep crashing